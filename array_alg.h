@@ -14,7 +14,7 @@ There are no new data structures. Just include the library and call functions on
 Features:
 
 - Sets (intersection, union, subset, etc)
-- Heaps (priority queues)
+- Heaps (priority queues, indexed heaps with decrease key, min-max heaps, radix heaps)
 - Binary search (lower bound, upper bound, etc)
 - Sorts (insertion sort, quick sort, merge/stable sort, heap sort, partial sort, etc)
 - Partitioning (partition, unique, etc)
@@ -44,6 +44,25 @@ to avoid the need for separate implementations.
 
 Repeat this process for each array type you want to use.
 
+Some functions are only generated when the element type opts in.
+Define these along with `ARRAY_ALG_TYPE`, for both declarations and implementations:
+
+- `ARRAY_ALG_INDEX(x)`: unique id of an element, for indexed heaps.
+- `ARRAY_ALG_KEY(x)`: unsigned integer key of an element, for radix heaps.
+- `ARRAY_ALG_ARITHMETIC`: the type is a built-in number, compared with `<`. Enables S-trees and SIMD paths.
+- `ARRAY_ALG_INTEGER`: the type is a built-in integer of at most 32 bits. Enables packed sets and roaring sets.
+  Other types fail to build.
+- `ARRAY_ALG_PREDICATE(x)`: an expression which is true for the `const T *x` to select.
+  Generates only `find_if_inline`, `count_if_inline`, etc, which inline it instead of calling a function pointer.
+  Use a separate prefix for each predicate, next to a regular instantiation of the type.
+- `ARRAY_ALG_BYTEWISE_EQ`: comparators return 0 exactly when the bytes of two elements are equal (no padding, no floats).
+  `equal` becomes a `memcmp`.
+- `ARRAY_ALG_BYTEWISE_ORDER`: comparators order elements like `memcmp` does, such as `unsigned char`.
+  Not plain `char`, which is signed on most platforms.
+  Implies `ARRAY_ALG_BYTEWISE_EQ`. `lexicographical_compare` becomes a `memcmp`.
+
+Define `ARRAY_ALG_THREADS` to generate the functions which use pthreads (multiqueues, parallel merges and set operations).
+
 ## Examples
 
 Remove duplicate entries:
@@ -79,6 +98,16 @@ TODO:
 #include <stddef.h>
 #include <assert.h>
 
+#ifdef ARRAY_ALG_THREADS
+#include <pthread.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -104,12 +133,157 @@ extern "C"
 #define ARRAY_ALG_RANDOM(_n) (rand() % (_n))
 #endif
 
+#ifndef ARRAY_ALG_PREFETCH
+#if defined(__GNUC__)
+#define ARRAY_ALG_PREFETCH(_p) __builtin_prefetch(_p)
+#else
+#define ARRAY_ALG_PREFETCH(_p) ((void)0)
+#endif
+#endif
+
+#ifndef ARRAY_ALG_GALLOP_RATIO
+// Set operations gallop through the larger range,
+// when it is at least this many times the size of the smaller one.
+#define ARRAY_ALG_GALLOP_RATIO 32
+#endif
+
+#ifndef ARRAY_ALG_COMMON_
+#define ARRAY_ALG_COMMON_
+
+/// Number of bits needed to represent x. 0 for x = 0.
+static inline int array_alg_bit_width(uint64_t x) {
+#if defined(__GNUC__)
+    return x == 0 ? 0 : 64 - __builtin_clzll(x);
+#else
+    int width = 0;
+    while (x) {
+        x >>= 1;
+        ++width;
+    }
+    return width;
+#endif
+}
+
+/// Number of zero bits below the lowest set bit. 64 for x = 0.
+static inline int array_alg_count_trailing_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return x == 0 ? 64 : __builtin_ctzll(x);
+#else
+    int count = 0;
+    while (count < 64 && !(x & 1)) {
+        x >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+static inline int array_alg_popcount(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int count = 0;
+    while (x) {
+        x &= x - 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/// Bytes compared at once by the SIMD scans (find_value, count_value, etc).
+#if defined(__AVX2__)
+#define ARRAY_ALG_SCAN_BYTES 32
+#elif defined(__SSE2__)
+#define ARRAY_ALG_SCAN_BYTES 16
+#endif
+
+#if defined(__AVX2__) && defined(__BMI2__)
+/// Permutation which moves the 32 bit lanes selected by mask to the front, in order.
+static inline __m256i array_alg_left_pack_epi32(unsigned mask) {
+    uint64_t expanded = _pdep_u64(mask, 0x0101010101010101ULL) * 0xFF;
+    uint64_t indices = _pext_u64(0x0706050403020100ULL, expanded);
+    return _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)indices));
+}
+#endif
+
+/// xorshift64* generator for callers which need a cheap random stream per thread.
+/// requires:
+/// - *state != 0
+static inline uint64_t array_alg_random_u64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+#endif
+
 #define NAME2(prefix, fun) prefix ## fun
 #define NAME1(prefix, fun) NAME2(prefix, fun)
 #define NS(fun) NAME1(ARRAY_ALG_PREFIX, fun)
 
 #define T ARRAY_ALG_TYPE
 
+#ifdef ARRAY_ALG_PREDICATE
+/// Versions of the scans with ARRAY_ALG_PREDICATE(x) in place of a predicate function.
+/// Inlining it lets the compiler unroll and vectorize the loops.
+/// An instantiation with ARRAY_ALG_PREDICATE generates only these.
+
+/// Tests blocks of 16 elements before branching, so ARRAY_ALG_PREDICATE may be evaluated
+/// on up to 15 elements past the one returned. It must not have side effects.
+ALGDEF T *NS(find_if_inline)(
+        const T *first,
+        const T *last
+        );
+
+ALGDEF int NS(any_of_inline)(
+        const T *first,
+        const T *last
+        );
+
+/// Like find_if_inline, may evaluate ARRAY_ALG_PREDICATE on up to 15 elements past the first false one.
+ALGDEF int NS(all_of_inline)(
+        const T *first,
+        const T *last
+        );
+
+ALGDEF int NS(none_of_inline)(
+        const T *first,
+        const T *last
+        );
+
+ALGDEF size_t NS(count_if_inline)(
+        const T *first,
+        const T *last
+        );
+
+ALGDEF T *NS(remove_if_inline)(
+        T *first,
+        T *last
+        );
+
+ALGDEF T *NS(copy_if_inline)(
+        const T *first,
+        const T *last,
+        T *out
+        );
+
+ALGDEF T *NS(partition_inline)(
+        T *first,
+        T *last
+        );
+
+/// Stable, like partition_copy.
+ALGDEF void NS(partition_copy_inline)(
+        const T *first,
+        const T *last,
+        T **out_true,
+        T **out_false
+        );
+#else
 
 /// Find the first element satisfying a predicate.
 ALGDEF T *NS(find_if)(
@@ -272,6 +446,38 @@ ALGDEF T *NS(merge)(
         void *compare_ctx
         );
 
+/// Like merge, but the element to write and both advances are selected arithmetically,
+/// so the only branch is the loop condition.
+/// This removes mispredictions, but the next comparison has to wait for the last one,
+/// so it is only faster when compare is cheap and can be inlined.
+/// requires:
+/// - is_sorted(first_1, last_1)
+/// - is_sorted(first_2, last_2)
+ALGDEF T *NS(merge_branchless)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Like merge_branchless, but also writes from the back,
+/// so each iteration has two independent comparisons in flight.
+/// requires:
+/// - is_sorted(first_1, last_1)
+/// - is_sorted(first_2, last_2)
+ALGDEF T *NS(merge_bidirectional)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
 /// requires:
 /// - is_sorted(first, middle)
 /// - is_sorted(middle, last)
@@ -285,6 +491,23 @@ ALGDEF void NS(merge_with_buffer)(
         void *compare_ctx
         );
 
+/// The number of elements of range 1 among the first `diagonal` elements written by merge.
+/// Merging [first_1, first_1 + i) with [first_2, first_2 + diagonal - i)
+/// and then the rest of each range gives the same result as one merge,
+/// so the two halves can be merged independently.
+/// Costs O(log n) comparisons.
+/// requires:
+/// - diagonal <= (last_1 - first_1) + (last_2 - first_2)
+ALGDEF size_t NS(merge_path)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        size_t diagonal,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
 ALGDEF T *NS(remove_if)(
         T *first,
         T *last,
@@ -346,6 +569,7 @@ ALGDEF T *NS(fill_n)(
         const T *x
         );
 
+/// Gallops through super when it is much larger than sub.
 ALGDEF int NS(set_includes)(
         const T *first_sub,
         const T *last_sub,
@@ -365,6 +589,8 @@ ALGDEF T *NS(set_union)(
         void* cmp_ctx
         );
 
+/// Like set_intersection, gallops when the sizes are skewed.
+/// out may equal first_1, to remove the elements of range 2 in place.
 ALGDEF T *NS(set_difference)(
         const T *first_1,
         const T *last_1,
@@ -375,6 +601,8 @@ ALGDEF T *NS(set_difference)(
         void* cmp_ctx
         );
 
+/// Gallops through whichever range is much larger than the other,
+/// so the cost is O(m log(n / m)) for sizes m < n, rather than O(m + n).
 ALGDEF T *NS(set_intersection)(
         const T *first_1,
         const T *last_1,
@@ -385,6 +613,78 @@ ALGDEF T *NS(set_intersection)(
         void* cmp_ctx
         );
 
+/// Sizes of set_intersection, set_union and set_difference, without writing the elements.
+/// Every element of either range is in the union or matched in the intersection,
+/// so all three are found from one intersection pass, which gallops when the sizes are skewed.
+ALGDEF size_t NS(set_intersection_size)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+ALGDEF size_t NS(set_union_size)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+ALGDEF size_t NS(set_difference_size)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+/// All three set sizes from a single pass.
+/// For example, the Jaccard similarity is intersection_size / union_size.
+ALGDEF void NS(set_stats)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        size_t *intersection_size,
+        size_t *union_size,
+        size_t *difference_size,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+/// Intersection of k sorted ranges, [firsts[i], lasts[i]).
+/// Candidates come from the smallest range, and the others are galloped through
+/// from smallest to largest, so large ranges cost little more than the smallest one.
+/// Calls malloc.
+/// Returns NULL if allocation failed.
+ALGDEF T *NS(set_intersection_k)(
+        const T **firsts,
+        const T **lasts,
+        size_t k,
+        T *restrict out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+/// Union of k sorted ranges, [firsts[i], lasts[i]), merged with a heap of the ranges.
+/// Like set_union, an element repeated in several ranges is written
+/// as many times as the most it is repeated in one of them.
+/// Calls malloc.
+/// Returns NULL if allocation failed.
+ALGDEF T *NS(set_union_k)(
+        const T **firsts,
+        const T **lasts,
+        size_t k,
+        T *restrict out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
 ALGDEF T *NS(min)(
         const T* a,
         const T* b,
@@ -527,6 +827,9 @@ ALGDEF int NS(binary_search)(
         void* cmp_ctx
         );
 
+/// Finds [lower_bound, upper_bound) with a single descent.
+/// Once an element equal to value is found, the remaining halves
+/// on either side are searched for the two bounds.
 ALGDEF void NS(equal_range)(
         const T *first,
         const T *last,
@@ -537,1384 +840,5598 @@ ALGDEF void NS(equal_range)(
         void* cmp_ctx
         );
 
-ALGDEF int NS(next_permutation)(
-        T *first,
-        T *last,
+/// Number of elements equal to value in a sorted range.
+/// Same as upper_bound - lower_bound, using equal_range.
+ALGDEF size_t NS(count_equal)(
+        const T *first,
+        const T *last,
+        const T *value,
         int (*cmp)(const T*, const T*, void*),
         void* cmp_ctx
         );
 
-/// See random_shuffle.
-ALGDEF void NS(random_shuffle_n)(
-        T *first,
-        size_t n
+/// Like lower_bound, but searches outward from hint, checking 1, 2, 4, ... elements away,
+/// then binary searches the last gap.
+/// Costs O(log d) comparisons, where d is the distance from hint to the result,
+/// so it is faster than lower_bound when the result is known to be near hint.
+/// requires:
+/// - first <= hint <= last
+ALGDEF T *NS(lower_bound_hint)(
+        const T *first,
+        const T *last,
+        const T *hint,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
         );
 
-ALGDEF void NS(random_shuffle)(
-        T *first,
-        T *last
+/// Like upper_bound, but searches outward from hint.
+/// See lower_bound_hint.
+ALGDEF T *NS(upper_bound_hint)(
+        const T *first,
+        const T *last,
+        const T *hint,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
         );
 
-/// Select count random elements from the range [first, last).
-/// Each element has an equal probability of being selected.
-/// Each element will be selected at most once.
-ALGDEF T *NS(sample)(
+/// Find the lower_bound of many values at once.
+/// out_positions[i] will be the index of lower_bound(first, last, queries + i).
+/// Several searches run in lockstep so their cache misses overlap.
+ALGDEF void NS(lower_bound_batch)(
         const T *first,
         const T *last,
-        T* out,
-        size_t count
+        const T *queries,
+        size_t query_count,
+        size_t *out_positions,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
         );
 
-ALGDEF T *NS(is_heap_until)(
-        T *first,
-        T *last,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
+/// Like lower_bound_batch, but for sorted queries.
+/// Each search gallops forward from the previous answer,
+/// which costs O(query_count * log(n / query_count)) comparisons.
+/// requires:
+/// - is_sorted(queries, queries + query_count)
+ALGDEF void NS(lower_bound_batch_sorted)(
+        const T *first,
+        const T *last,
+        const T *queries,
+        size_t query_count,
+        size_t *out_positions,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
         );
 
-ALGDEF int NS(is_heap)(
-        T *first,
-        T *last,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
+#ifndef ARRAY_ALG_CASCADE_
+#define ARRAY_ALG_CASCADE_
+/// Fractional cascading over k sorted arrays.
+/// Level i merges array i with every second element of level i + 1,
+/// and each element links to its position in array i and in level i + 1.
+/// The links are 32-bit and stored next to the value,
+/// so following them costs one cache miss per level.
+/// See cascade_build and cascade_lower_bound.
+typedef struct {
+    /// The elements of every level with their links,
+    /// each level followed by one more node holding the links for its end.
+    void *nodes;
+    /// Level i has offsets[i + 1] - offsets[i] elements and starts at node offsets[i] + i.
+    size_t *offsets;
+    size_t k;
+} array_alg_cascade;
+#endif
+
+/// Build a cascade from k sorted arrays, [firsts[i], lasts[i]).
+/// Elements are copied, so the arrays do not need to outlive it.
+/// The levels hold up to twice as many elements as the arrays, each with 8 bytes of links,
+/// so for int it uses about 6 times the memory of the arrays.
+/// Beats a lower_bound on each array when the levels fit in cache or the arrays do not,
+/// but not in between.
+/// Calls malloc.
+/// Returns 0 if allocation failed or a level has 2^32 or more elements.
+/// requires:
+/// - is_sorted(firsts[i], lasts[i]) for each i < k
+ALGDEF int NS(cascade_build)(
+        array_alg_cascade *cascade,
+        const T **firsts,
+        const T **lasts,
+        size_t k,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
         );
 
-/// See push_heap
-ALGDEF void NS(push_heap_n)(
-        T *first,
-        size_t count,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
+ALGDEF void NS(cascade_free)(
+        array_alg_cascade *cascade
         );
 
-/// The item at the end of the range: (last - 1)
-/// Will be inserted into the heap [first, last - 1)
-/// [first, last) will then be a heap.
+/// Find the lower_bound of value in each of the k arrays.
+/// out_positions[i] will be the index of lower_bound(firsts[i], lasts[i], value).
+/// Costs one binary search plus O(1) steps for each array, so O(log n + k).
+ALGDEF void NS(cascade_lower_bound)(
+        const array_alg_cascade *cascade,
+        const T *value,
+        size_t *out_positions,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        );
+
+/// Eytzinger layout stores a sorted array in breadth first order of a binary search tree,
+/// so the top levels of every search share cache lines and the next levels can be prefetched.
 /// requires:
-///   - is_heap(first, last)
+/// - is_sorted(sorted_first, sorted_last)
+/// - sizeof(out) >= (sorted_last - sorted_first) + 1
+///   out[0] is unused so that the children of out[k] are out[2k] and out[2k + 1].
+ALGDEF void NS(eytzinger_build)(
+        const T *sorted_first,
+        const T *sorted_last,
+        T *out
+        );
 
-ALGDEF void NS(push_heap)(
-        T *first,
-        T *last,
-        int (*compare)(const T*, const T*, void *),
-        void *compare_ctx
+/// Like lower_bound on the sorted array used to build the layout.
+/// Returns the index in the sorted order, or n if every element is less than value.
+ALGDEF size_t NS(eytzinger_lower_bound)(
+        const T *eytzinger,
+        size_t n,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
         );
 
+#ifdef ARRAY_ALG_ARITHMETIC
+/// S-trees are static B+ trees with 16 keys per node, searched with SIMD compares.
+/// Internal nodes hold the smallest key of each child but the first, and the leaves hold every key in order.
+/// Each level is one node load, instead of the four levels of a binary search.
+///
+/// Only for arithmetic types, which are compared with `<`.
+/// Align the tree to 64 bytes for best performance.
 
-/// See pop_heap
-ALGDEF void NS(pop_heap_n)(
-        T *first,
-        size_t count,
-        int (*compare)(const T*, const T*, void *),
-        void *compare_ctx
+/// The number of elements needed to store an S-tree of n keys.
+ALGDEF size_t NS(stree_size)(
+        size_t n
         );
 
-/// The largest item in the heap will be moved to the end: (last - 1).
-/// The remaining range [first, last - 1) will be a heap.
 /// requires:
-///    - is_heap(first, last - 1)
-ALGDEF void NS(pop_heap)(
-        T *first,
-        T *last,
-        int (*compare)(const T*, const T*, void *),
-        void *compare_ctx
+/// - is_sorted(sorted_first, sorted_last)
+/// - sizeof(out) >= stree_size(sorted_last - sorted_first)
+ALGDEF void NS(stree_build)(
+        const T *sorted_first,
+        const T *sorted_last,
+        T *out
         );
 
-/// Create max heap from the range [first, first + count).
-ALGDEF void NS(make_heap_n)(
-        T *first,
-        size_t count,
-        int (*compare)(const T*, const T*, void *),
-        void *compare_ctx
+/// Like lower_bound on the sorted array used to build the tree.
+/// Returns the index in the sorted order, or n if every element is less than value.
+ALGDEF size_t NS(stree_lower_bound)(
+        const T *stree,
+        size_t n,
+        const T *value
         );
 
-/// Create max heap from the range [first, last).
-/// requires:
-/// - is_heap(first, last)
-ALGDEF void NS(make_heap)(
+/// Like lower_bound, but starts from a guess interpolated between the first and last keys,
+/// then gallops from there (see lower_bound_hint).
+/// Uniformly distributed keys take O(log log n) comparisons,
+/// and the worst case is O(log n).
+ALGDEF T *NS(interpolation_lower_bound)(
+        const T *first,
+        const T *last,
+        const T *value
+        );
+
+/// Like find_if with a predicate for == value, but compares a vector of elements at a time.
+/// Integers of one byte use memchr.
+ALGDEF T *NS(find_value)(
+        const T *first,
+        const T *last,
+        const T *value
+        );
+
+ALGDEF size_t NS(count_value)(
+        const T *first,
+        const T *last,
+        const T *value
+        );
+
+/// Find the first element equal to any of [values_first, values_last).
+/// Meant for a handful of values. Each one costs another compare per vector.
+ALGDEF T *NS(find_first_of_values)(
+        const T *first,
+        const T *last,
+        const T *values_first,
+        const T *values_last
+        );
+
+/// Find the first element x with low <= x < high.
+ALGDEF T *NS(find_in_range)(
+        const T *first,
+        const T *last,
+        const T *low,
+        const T *high
+        );
+
+/// Count the elements x with low <= x < high.
+ALGDEF size_t NS(count_in_range)(
+        const T *first,
+        const T *last,
+        const T *low,
+        const T *high
+        );
+
+/// Like min_element compared with `<`, and the same position on ties.
+/// Reduces independent lanes the compiler can vectorize,
+/// then finds the first element equal to the minimum.
+ALGDEF T *NS(min_element_simd)(
+        const T *first,
+        const T *last
+        );
+
+/// Like max_element compared with `<`. Returns the first maximum.
+ALGDEF T *NS(max_element_simd)(
+        const T *first,
+        const T *last
+        );
+
+/// Like minmax_element compared with `<`. Returns the first minimum and the last maximum.
+ALGDEF void NS(minmax_element_simd)(
+        const T *first,
+        const T *last,
+        T** out_min,
+        T** out_max
+        );
+
+/// Like unique compared with `==`, so NaNs are all kept.
+/// Compares and packs a vector at a time.
+ALGDEF T *NS(unique_simd)(
+        T *first,
+        T *last
+        );
+
+#ifndef ARRAY_ALG_PLA_SEGMENT_
+#define ARRAY_ALG_PLA_SEGMENT_
+/// One piece of a learned index.
+/// Keys from `key` up to the key of the next segment are predicted
+/// to be at position `intercept + slope * (x - key)`.
+typedef struct {
+    double key;
+    double slope;
+    double intercept;
+} array_alg_pla_segment;
+#endif
+
+/// A learned index is a piecewise linear model of the position of each key in a sorted array,
+/// with every distinct key predicted within max_error of its lower_bound.
+/// It is built in one pass with the shrinking cone algorithm.
+/// The segments are plain data, so they can be saved and loaded along with the array.
+/// Returns the number of segments.
+/// requires:
+/// - is_sorted(sorted_first, sorted_last)
+/// - sizeof(out) >= ((sorted_last - sorted_first) + 1) / 2
+ALGDEF size_t NS(learned_index_build)(
+        const T *sorted_first,
+        const T *sorted_last,
+        size_t max_error,
+        array_alg_pla_segment *out
+        );
+
+/// Like lower_bound, but only searches within max_error of the predicted position.
+/// If the result is outside that window, for values not in the array,
+/// the search continues with lower_bound_hint.
+/// requires:
+/// - segments was built from [first, last) with the same max_error.
+ALGDEF T *NS(learned_index_lower_bound)(
+        const T *first,
+        const T *last,
+        const array_alg_pla_segment *segments,
+        size_t segment_count,
+        size_t max_error,
+        const T *value
+        );
+
+/// Like set_intersection, but for sets without duplicates.
+/// 32 bit integers are compared a block at a time, every element of one block
+/// against every element of the other with SIMD, and the matches are packed into out.
+/// requires:
+/// - both ranges are strictly increasing
+/// - out does not overlap either range
+ALGDEF T *NS(set_intersection_simd)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out
+        );
+
+/// Size of set_intersection_simd, without writing the elements.
+/// requires:
+/// - both ranges are strictly increasing
+ALGDEF size_t NS(set_intersection_count)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2
+        );
+#endif
+
+#ifdef ARRAY_ALG_INTEGER
+// T must be an integer type of at most 32 bits.
+extern char NS(_integer_check)[((T)0.5 == 0 && sizeof(T) <= 4) ? 1 : -1];
+
+#ifndef ARRAY_ALG_PACKED_SET_
+#define ARRAY_ALG_PACKED_SET_
+enum {
+    ARRAY_ALG_PACKED_BLOCK = 128
+};
+
+/// Skip entry for one block of a packed set.
+typedef struct {
+    /// Smallest and largest key in the block.
+    uint32_t first;
+    uint32_t last;
+    /// Bits per difference.
+    uint32_t width;
+    /// Index of the block's first word.
+    size_t offset;
+} array_alg_packed_block;
+
+/// Packed sets compress a sorted array of integers of at most 32 bits.
+/// Each block of 128 values stores the difference of each value from the one before,
+/// packed with the bit width of the largest difference in the block.
+/// Dense ids take a few bits each, instead of 32.
+/// See packed_set_build.
+typedef struct {
+    uint32_t *words;
+    array_alg_packed_block *blocks;
+    size_t size;
+    size_t word_count;
+    size_t block_count;
+} array_alg_packed_set;
+
+/// Memory used by the packed set, not counting the struct itself.
+static inline size_t array_alg_packed_set_bytes(const array_alg_packed_set *set) {
+    return (set->word_count + 1) * sizeof(uint32_t) + set->block_count * sizeof(array_alg_packed_block);
+}
+#endif
+
+/// Calls malloc.
+/// Returns 0 if allocation failed.
+/// requires:
+/// - T is an integer type of at most 32 bits
+/// - is_sorted(first, last)
+ALGDEF int NS(packed_set_build)(
+        array_alg_packed_set *set,
+        const T *first,
+        const T *last
+        );
+
+ALGDEF void NS(packed_set_free)(
+        array_alg_packed_set *set
+        );
+
+/// Write every value of the set to out, in order.
+/// Returns the end of the output.
+ALGDEF T *NS(packed_set_decode)(
+        const array_alg_packed_set *set,
+        T *out
+        );
+
+/// Like lower_bound on the array the set was built from.
+/// Binary searches the skip entries, then decodes one block.
+/// Returns the index in the array, or size if every element is less than value.
+ALGDEF size_t NS(packed_set_lower_bound)(
+        const array_alg_packed_set *set,
+        const T *value
+        );
+
+/// Like set_intersection on the arrays the sets were built from.
+/// Blocks are decoded one at a time, and blocks which end before the
+/// current value of the other set are skipped without decoding.
+ALGDEF T *NS(packed_set_intersection)(
+        const array_alg_packed_set *a,
+        const array_alg_packed_set *b,
+        T *out
+        );
+
+/// Like set_union on the arrays the sets were built from, decoding one block at a time.
+ALGDEF T *NS(packed_set_union)(
+        const array_alg_packed_set *a,
+        const array_alg_packed_set *b,
+        T *out
+        );
+
+#ifndef ARRAY_ALG_ROARING_
+#define ARRAY_ALG_ROARING_
+enum {
+    ARRAY_ALG_ROARING_ARRAY,
+    ARRAY_ALG_ROARING_BITMAP,
+    ARRAY_ALG_ROARING_RUN,
+    /// Largest array container, the same size as a bitmap.
+    ARRAY_ALG_ROARING_ARRAY_MAX = 4096,
+    ARRAY_ALG_ROARING_BITMAP_WORDS = 1024
+};
+
+/// The values of a roaring set which share their high 16 bits.
+typedef struct {
+    /// Array: sorted low bits. Bitmap: 1024 64 bit words.
+    /// Run: pairs of (start, length - 1).
+    void *data;
+    uint32_t cardinality;
+    /// Number of values in an array, or runs in a run container.
+    uint32_t size;
+    uint16_t key;
+    uint8_t type;
+} array_alg_roaring_container;
+
+/// Roaring sets hold integers of at most 32 bits, split by their high 16 bits into containers.
+/// Each container is whichever is smallest of a sorted array, a bitmap, or a list of runs,
+/// so sparse, dense and clustered ranges all stay compact.
+/// Operations on two bitmaps are word-wise ANDs and ORs.
+/// See roaring_build.
+typedef struct {
+    array_alg_roaring_container *containers;
+    size_t count;
+} array_alg_roaring;
+#endif
+
+/// Duplicates are only stored once.
+/// Calls malloc.
+/// Returns 0 if allocation failed.
+/// requires:
+/// - T is an integer type of at most 32 bits
+/// - is_sorted(first, last)
+ALGDEF int NS(roaring_build)(
+        array_alg_roaring *set,
+        const T *first,
+        const T *last
+        );
+
+ALGDEF void NS(roaring_free)(
+        array_alg_roaring *set
+        );
+
+ALGDEF size_t NS(roaring_cardinality)(
+        const array_alg_roaring *set
+        );
+
+/// Write every value of the set to out, in order.
+/// Returns the end of the output.
+ALGDEF T *NS(roaring_decode)(
+        const array_alg_roaring *set,
+        T *out
+        );
+
+/// out = a and b.
+/// Calls malloc.
+/// Returns 0 if allocation failed.
+ALGDEF int NS(roaring_intersection)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        array_alg_roaring *out
+        );
+
+/// out = a or b.
+/// Calls malloc.
+/// Returns 0 if allocation failed.
+ALGDEF int NS(roaring_union)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        array_alg_roaring *out
+        );
+
+/// out = a and not b.
+/// Calls malloc.
+/// Returns 0 if allocation failed.
+ALGDEF int NS(roaring_difference)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        array_alg_roaring *out
+        );
+#endif
+
+ALGDEF int NS(next_permutation)(
         T *first,
         T *last,
-        int (*compare)(const T*, const T*, void*),
-        void *compare_ctx
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
         );
 
-/// Given a heap, reorder elements until they are sorted.
-ALGDEF void NS(sort_heap)(
+/// See random_shuffle.
+ALGDEF void NS(random_shuffle_n)(
+        T *first,
+        size_t n
+        );
+
+ALGDEF void NS(random_shuffle)(
+        T *first,
+        T *last
+        );
+
+/// Select count random elements from the range [first, last).
+/// Each element has an equal probability of being selected.
+/// Each element will be selected at most once.
+ALGDEF T *NS(sample)(
+        const T *first,
+        const T *last,
+        T* out,
+        size_t count
+        );
+
+ALGDEF T *NS(is_heap_until)(
         T *first,
         T *last,
-        int (*compare)(const T*, const T*, void*),
-        void *compare_ctx
+        int (*compare)(const T*, const T*, void *),
+        void* compare_ctx
         );
 
-ALGDEF void NS(insertion_sort)(
+ALGDEF int NS(is_heap)(
         T *first,
         T *last,
-        int (*compare)(const T* a, const T* b, void*),
+        int (*compare)(const T*, const T*, void *),
         void* compare_ctx
         );
 
-ALGDEF void NS(sort)(
+/// See push_heap
+ALGDEF void NS(push_heap_n)(
+        T *first,
+        size_t count,
+        int (*compare)(const T*, const T*, void *),
+        void* compare_ctx
+        );
+
+/// The item at the end of the range: (last - 1)
+/// Will be inserted into the heap [first, last - 1)
+/// [first, last) will then be a heap.
+/// requires:
+///   - is_heap(first, last)
+
+ALGDEF void NS(push_heap)(
         T *first,
         T *last,
-        int (*compare)(const T*, const T*, void*),
+        int (*compare)(const T*, const T*, void *),
         void *compare_ctx
         );
 
-ALGDEF void NS(insertion_sort_stable)(
+
+/// See pop_heap
+ALGDEF void NS(pop_heap_n)(
+        T *first,
+        size_t count,
+        int (*compare)(const T*, const T*, void *),
+        void *compare_ctx
+        );
+
+/// The largest item in the heap will be moved to the end: (last - 1).
+/// The remaining range [first, last - 1) will be a heap.
+/// requires:
+///    - is_heap(first, last - 1)
+ALGDEF void NS(pop_heap)(
         T *first,
         T *last,
-        int (*compare)(const T*, const T*, void*),
+        int (*compare)(const T*, const T*, void *),
         void *compare_ctx
         );
 
-/// Sort an array in a stable way with a merge sort variety.
-/// By stable, we mean that the order of equivalent elements is preserved.
-/// Calls malloc.
-ALGDEF void NS(stable_sort)(
-        T* first,
-        T* last,
-        int (*compare)(const T*, const T*, void*),
-        void* compare_ctx
+/// Create max heap from the range [first, first + count).
+ALGDEF void NS(make_heap_n)(
+        T *first,
+        size_t count,
+        int (*compare)(const T*, const T*, void *),
+        void *compare_ctx
         );
 
-/// Like above, but does not call malloc.
-/// You must provide a buffer.
+/// Create max heap from the range [first, last).
 /// requires:
-/// - sizeof(buffer) >= (last - first) / 2
-ALGDEF void NS(stable_sort_with_buffer)(
-        T* first,
-        T* last,
-        T* buffer,
+/// - is_heap(first, last)
+ALGDEF void NS(make_heap)(
+        T *first,
+        T *last,
         int (*compare)(const T*, const T*, void*),
-        void* compare_ctx
+        void *compare_ctx
         );
 
-ALGDEF void NS(partial_sort)(
+/// Given a heap, reorder elements until they are sorted.
+ALGDEF void NS(sort_heap)(
         T *first,
-        T *middle,
         T *last,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         );
 
-ALGDEF T *NS(partial_sort_copy)(
-        const T *first,
-        const T *last,
-        T *out_first,
-        T *out_last,
+/// Min-max heaps are double ended priority queues.
+/// Nodes on even levels are smaller than all of their descendants,
+/// and nodes on odd levels are larger than all of their descendants.
+/// The smallest element is always at first,
+/// and the largest is one of the first three (see minmax_heap_max).
+
+/// The item at the end of the range: (last - 1)
+/// Will be inserted into the min-max heap [first, last - 1)
+/// requires:
+///   - is_minmax_heap(first, last - 1)
+ALGDEF void NS(push_minmax_heap)(
+        T *first,
+        T *last,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         );
 
-ALGDEF void NS(nth_element)(
+/// The smallest item in the heap will be moved to the end: (last - 1).
+/// The remaining range [first, last - 1) will be a min-max heap.
+ALGDEF void NS(pop_minmax_heap_min)(
         T *first,
-        T *nth,
         T *last,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
-);
+        );
 
-/// See is_strictly_increasing
-ALGDEF T *NS(is_strictly_increasing_until)(
-        const T *first,
-        const T *last,
+/// The largest item in the heap will be moved to the end: (last - 1).
+/// The remaining range [first, last - 1) will be a min-max heap.
+ALGDEF void NS(pop_minmax_heap_max)(
+        T *first,
+        T *last,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         );
 
-/// A sequence is strictly increasing when
-/// compare(p, p+1) < 0 for all valid pointers in the range.
-ALGDEF int NS(is_strictly_increasing)(
+/// Find the largest item in a min-max heap in O(1).
+/// Returns last if the heap is empty.
+ALGDEF T *NS(minmax_heap_max)(
         const T *first,
         const T *last,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         );
 
-/// Insert n elements at first.
-/// The elements at [first, last) will first be shifted up
-/// to [first + n, last + n) to make room.
-///
-/// requires:
-/// - [first, last + n) is a valid range.
-
-ALGDEF T* NS(insert_n)(
+/// Create a min-max heap from the range [first, last).
+ALGDEF void NS(make_minmax_heap)(
         T *first,
         T *last,
-        const T *to_insert_first,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+ALGDEF int NS(is_minmax_heap)(
+        const T *first,
+        const T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+#ifdef ARRAY_ALG_KEY
+/// Radix heaps are min heaps for integer keys which never go below the last key popped,
+/// such as event times in a simulation or distances in Dijkstra.
+/// `ARRAY_ALG_KEY(x)` must map an element to an unsigned integer key of at most 64 bits.
+///
+/// Elements are grouped into buckets by the highest bit in which their key differs
+/// from the last key popped. The buckets are stored from largest to smallest,
+/// so pushing and popping move at most one element per bucket.
+
+#ifndef ARRAY_ALG_RADIX_HEAP_
+#define ARRAY_ALG_RADIX_HEAP_
+enum { ARRAY_ALG_RADIX_HEAP_BUCKETS = 65 };
+
+typedef struct {
+    uint64_t last_key;
+    /// Bucket b occupies [bounds[b + 1], bounds[b]).
+    /// bounds[0] is the size of the heap.
+    size_t bounds[ARRAY_ALG_RADIX_HEAP_BUCKETS + 1];
+} array_alg_radix_heap;
+#endif
+
+/// Create a radix heap from the range [first, last).
+/// Use an empty range to initialize an empty heap.
+ALGDEF void NS(make_radix_heap)(
+        T *first,
+        T *last,
+        array_alg_radix_heap *heap
+        );
+
+/// The item at the end of the range: (last - 1)
+/// Will be inserted into the radix heap [first, last - 1)
+/// requires:
+/// - ARRAY_ALG_KEY(last - 1) >= heap->last_key
+ALGDEF void NS(push_radix_heap)(
+        T *first,
+        T *last,
+        array_alg_radix_heap *heap
+        );
+
+/// An item with the smallest key will be moved to the end: (last - 1).
+/// The remaining range [first, last - 1) will be a radix heap.
+ALGDEF void NS(pop_radix_heap)(
+        T *first,
+        T *last,
+        array_alg_radix_heap *heap
+        );
+#endif
+
+#ifdef ARRAY_ALG_THREADS
+/// MultiQueues are relaxed concurrent max priority queues.
+/// Pushes go to a random heap and pops take the better top of two random heaps,
+/// each guarded by its own lock. Locks are only taken with trylock: a busy heap is skipped,
+/// never waited for. Pops return one of the largest elements,
+/// but not necessarily the largest, in exchange for scaling with the number of threads.
+/// Use 2-4 heaps per thread.
+///
+/// Each thread should pass its own random `seed` (any nonzero value to start).
+
+#ifndef ARRAY_ALG_MULTIQUEUE_
+#define ARRAY_ALG_MULTIQUEUE_
+
+/// One sequential heap of a multiqueue.
+/// Padded to keep each lock on its own cache lines.
+typedef union {
+    struct {
+        pthread_mutex_t lock;
+        size_t size;
+    } queue;
+    char padding[128];
+} array_alg_multiqueue_slot;
+
+/// A relaxed concurrent priority queue made of many sequential heaps.
+/// See multiqueue_push and multiqueue_pop.
+typedef struct {
+    void *heaps;
+    array_alg_multiqueue_slot *slots;
+    size_t queue_count;
+    size_t capacity;
+} array_alg_multiqueue;
+
+#endif
+
+/// Calls malloc.
+/// Returns 0 if queue_count is 0, or if allocation or creating a lock failed.
+ALGDEF int NS(multiqueue_init)(
+        array_alg_multiqueue *mq,
+        size_t queue_count,
+        size_t capacity
+        );
+
+ALGDEF void NS(multiqueue_free)(
+        array_alg_multiqueue *mq
+        );
+
+/// Returns 0 if the queue is full.
+ALGDEF int NS(multiqueue_push)(
+        array_alg_multiqueue *mq,
+        const T *value,
+        uint64_t *seed,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Returns 0 if the queue is empty.
+ALGDEF int NS(multiqueue_pop)(
+        array_alg_multiqueue *mq,
+        T *out,
+        uint64_t *seed,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Like merge, split into thread_count independent merges with merge_path.
+/// The calling thread does one part. If threads can't be started, it does their parts too.
+ALGDEF T *NS(merge_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Like set_union, split into thread_count parts with merge_path.
+/// Each split is moved back to the first of a run of equal elements, so runs are not divided.
+/// Output sizes are not known ahead of time, so each part is counted in parallel
+/// before any are written.
+/// requires:
+/// - out does not overlap either range
+ALGDEF T *NS(set_union_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+/// See set_union_parallel.
+ALGDEF T *NS(set_intersection_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+
+/// See set_union_parallel.
+ALGDEF T *NS(set_difference_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        );
+#endif
+
+#ifdef ARRAY_ALG_INDEX
+/// Indexed heaps are max heaps which also maintain a position map,
+/// so an element can be found and reprioritized after it is pushed.
+/// `ARRAY_ALG_INDEX(x)` must map an element to a unique id,
+/// and `positions` must have room for every id.
+///
+/// For every element x in the heap [first, last):
+///   first[positions[ARRAY_ALG_INDEX(x)]] is x.
+
+/// Like push_heap, but also records the position of every element moved.
+ALGDEF void NS(push_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Like pop_heap, but also records the position of every element moved.
+/// The popped element's position will be (last - 1).
+ALGDEF void NS(pop_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Create an indexed max heap from the range [first, last).
+/// `positions` does not need to be initialized.
+ALGDEF void NS(make_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Replace the element with the same id as `value` by `value`.
+/// requires:
+/// - the element is in the heap.
+/// - compare(value, old element) >= 0
+///
+/// Note that with a reversed comparator (a min heap, such as for Dijkstra)
+/// lowering a distance is an increase in key.
+ALGDEF void NS(increase_key_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        const T *value,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Replace the element with the same id as `value` by `value`.
+/// requires:
+/// - the element is in the heap.
+/// - compare(value, old element) <= 0
+ALGDEF void NS(decrease_key_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        const T *value,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// The element with the given id will be moved to the end: (last - 1).
+/// The remaining range [first, last - 1) will be a heap.
+/// requires:
+/// - the element is in the heap.
+ALGDEF void NS(erase_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        size_t id,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+#endif
+
+ALGDEF void NS(insertion_sort)(
+        T *first,
+        T *last,
+        int (*compare)(const T* a, const T* b, void*),
+        void* compare_ctx
+        );
+
+ALGDEF void NS(sort)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+ALGDEF void NS(insertion_sort_stable)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Sort an array in a stable way with a merge sort variety.
+/// By stable, we mean that the order of equivalent elements is preserved.
+/// Calls malloc.
+ALGDEF void NS(stable_sort)(
+        T* first,
+        T* last,
+        int (*compare)(const T*, const T*, void*),
+        void* compare_ctx
+        );
+
+/// Like above, but does not call malloc.
+/// You must provide a buffer.
+/// requires:
+/// - sizeof(buffer) >= (last - first) / 2
+ALGDEF void NS(stable_sort_with_buffer)(
+        T* first,
+        T* last,
+        T* buffer,
+        int (*compare)(const T*, const T*, void*),
+        void* compare_ctx
+        );
+
+ALGDEF void NS(partial_sort)(
+        T *first,
+        T *middle,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+ALGDEF T *NS(partial_sort_copy)(
+        const T *first,
+        const T *last,
+        T *out_first,
+        T *out_last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+ALGDEF void NS(nth_element)(
+        T *first,
+        T *nth,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+);
+
+/// See is_strictly_increasing
+ALGDEF T *NS(is_strictly_increasing_until)(
+        const T *first,
+        const T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// A sequence is strictly increasing when
+/// compare(p, p+1) < 0 for all valid pointers in the range.
+ALGDEF int NS(is_strictly_increasing)(
+        const T *first,
+        const T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        );
+
+/// Insert n elements at first.
+/// The elements at [first, last) will first be shifted up
+/// to [first + n, last + n) to make room.
+///
+/// requires:
+/// - [first, last + n) is a valid range.
+
+ALGDEF T* NS(insert_n)(
+        T *first,
+        T *last,
+        const T *to_insert_first,
         size_t n
         );
 
-#ifdef ARRAY_ALG_IMPLEMENTATION
+#endif
+
+#ifdef ARRAY_ALG_IMPLEMENTATION
+
+#if defined(__AVX2__) && defined(__BMI2__)
+/// Elements in a 32 byte vector, for left-packing the kept elements in copy_if, remove_if and unique.
+/// 0 when T is not 4 or 8 bytes. Only the bits are moved, so T need not be arithmetic.
+#define ARRAY_ALG_COMPACT_LANES (sizeof(T) == 4 ? 8 : sizeof(T) == 8 ? 4 : 0)
+
+/// Write the elements of the vector at in which are selected by mask to out, in order.
+/// Only the selected elements are written, so out may be at the end of a buffer.
+/// Returns how many there are.
+/// requires:
+/// - ARRAY_ALG_COMPACT_LANES != 0
+static size_t NS(_compact)(
+        const T *in,
+        unsigned mask,
+        T *out
+        ) {
+    // Select both halves of each 64 bit element.
+    if (sizeof(T) == 8) mask = (unsigned)_pdep_u32(mask, 0x55) * 3;
+
+    __m256i v = _mm256_loadu_si256((const __m256i*)in);
+    int count = array_alg_popcount(mask);
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    // Compressing to memory is slow on some cores, so compress in a register.
+    _mm256_mask_storeu_epi32(out, (__mmask8)((1u << count) - 1), _mm256_maskz_compress_epi32((__mmask8)mask, v));
+#else
+    __m256i packed = _mm256_permutevar8x32_epi32(v, array_alg_left_pack_epi32(mask));
+    __m256i keep = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    _mm256_maskstore_epi32((int*)out, keep, packed);
+#endif
+    return (size_t)count * 4 / sizeof(T);
+}
+#endif
+
+#ifdef ARRAY_ALG_PREDICATE
+/// Elements tested together by find_if_inline before branching.
+/// A branch free block is a loop the compiler can vectorize.
+#define ARRAY_ALG_PREDICATE_BLOCK 16
+
+ALGDEF T *NS(find_if_inline)(
+        const T *first,
+        const T *last
+        ) {
+    while (last - first >= ARRAY_ALG_PREDICATE_BLOCK) {
+        int any = 0;
+        for (int i = 0; i < ARRAY_ALG_PREDICATE_BLOCK; ++i) {
+            any |= (ARRAY_ALG_PREDICATE(first + i)) != 0;
+        }
+        if (any) break;
+        first += ARRAY_ALG_PREDICATE_BLOCK;
+    }
+
+    while (first != last && !(ARRAY_ALG_PREDICATE(first))) ++first;
+    return (T*)first;
+}
+
+ALGDEF int NS(any_of_inline)(
+        const T *first,
+        const T *last
+        ) {
+    return NS(find_if_inline)(first, last) != last;
+}
+
+ALGDEF int NS(all_of_inline)(
+        const T *first,
+        const T *last
+        ) {
+    while (last - first >= ARRAY_ALG_PREDICATE_BLOCK) {
+        int all = 1;
+        for (int i = 0; i < ARRAY_ALG_PREDICATE_BLOCK; ++i) {
+            all &= (ARRAY_ALG_PREDICATE(first + i)) != 0;
+        }
+        if (!all) return 0;
+        first += ARRAY_ALG_PREDICATE_BLOCK;
+    }
+
+    for (; first != last; ++first) {
+        if (!(ARRAY_ALG_PREDICATE(first))) return 0;
+    }
+    return 1;
+}
+
+ALGDEF int NS(none_of_inline)(
+        const T *first,
+        const T *last
+        ) {
+    return NS(find_if_inline)(first, last) == last;
+}
+
+ALGDEF size_t NS(count_if_inline)(
+        const T *first,
+        const T *last
+        ) {
+    size_t count = 0;
+    for (; first != last; ++first) {
+        count += (ARRAY_ALG_PREDICATE(first)) != 0;
+    }
+    return count;
+}
+
+ALGDEF T *NS(remove_if_inline)(
+        T *first,
+        T *last
+        ) {
+    T *out = first;
+#if defined(ARRAY_ALG_COMPACT_LANES)
+    if (ARRAY_ALG_COMPACT_LANES != 0) {
+        const size_t lanes = ARRAY_ALG_COMPACT_LANES;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            unsigned mask = 0;
+            for (size_t j = 0; j < lanes; ++j) mask |= (unsigned)((ARRAY_ALG_PREDICATE(first + j)) == 0) << j;
+            out += NS(_compact)(first, mask, out);
+        }
+    }
+#endif
+    // out never passes first, so every element can be stored without a branch.
+    for (; first != last; ++first) {
+        T x = *first;
+        *out = x;
+        out += !(ARRAY_ALG_PREDICATE(&x));
+    }
+    return out;
+}
+
+ALGDEF T *NS(copy_if_inline)(
+        const T *first,
+        const T *last,
+        T *out
+        ) {
+#if defined(ARRAY_ALG_COMPACT_LANES)
+    if (ARRAY_ALG_COMPACT_LANES != 0) {
+        const size_t lanes = ARRAY_ALG_COMPACT_LANES;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            unsigned mask = 0;
+            for (size_t j = 0; j < lanes; ++j) mask |= (unsigned)((ARRAY_ALG_PREDICATE(first + j)) != 0) << j;
+            out += NS(_compact)(first, mask, out);
+        }
+    }
+#endif
+    for (; first != last; ++first) {
+        if (ARRAY_ALG_PREDICATE(first)) {
+            *out = *first;
+            ++out;
+        }
+    }
+    return out;
+}
+
+ALGDEF T *NS(partition_inline)(
+        T *first,
+        T *last
+        ) {
+    T *out = first;
+    for (; first != last; ++first) {
+        if (ARRAY_ALG_PREDICATE(first)) {
+            T tmp = *out;
+            *out = *first;
+            *first = tmp;
+            ++out;
+        }
+    }
+    return out;
+}
+
+ALGDEF void NS(partition_copy_inline)(
+        const T *first,
+        const T *last,
+        T **out_true,
+        T **out_false
+        ) {
+    T *t = *out_true;
+    T *f = *out_false;
+    for (; first != last; ++first) {
+        if (ARRAY_ALG_PREDICATE(first)) {
+            *t = *first;
+            ++t;
+        } else {
+            *f = *first;
+            ++f;
+        }
+    }
+    *out_true = t;
+    *out_false = f;
+}
+#undef ARRAY_ALG_PREDICATE_BLOCK
+#else
+
+ALGDEF T *NS(find_if)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+
+    while (first != last) {
+        if (predicate(first, predicate_ctx)) break; 
+        ++first;
+    }
+    return (T*)first;
+}
+
+ALGDEF T *NS(find_if_not)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+
+    while (first != last) {
+        if (!predicate(first, predicate_ctx)) break; 
+        ++first;
+    }
+    return (T*)first;
+}
+
+ALGDEF T *NS(find_if_unguarded)(
+        const T *first,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        ) {
+
+    while (!predicate(first, predicate_ctx)) ++first;
+    return (T*)first;
+}
+
+ALGDEF T* NS(find_if_not_unguarded)(
+        const T *first,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        ) {
+
+    while (predicate(first, predicate_ctx)) ++first;
+    return (T*)first;
+}
+
+ALGDEF T *NS(find_last_if)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+
+    const T *found = last;
+
+    while (first != last) {
+        if (predicate(first, predicate_ctx)) {
+            found = first;
+        }
+        ++first;
+    }
+    return (T*)found;
+}
+
+ALGDEF int NS(any_of)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+    return NS(find_if)(first, last, predicate, predicate_ctx) != last;
+}
+
+ALGDEF int NS(none_of)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+    return NS(find_if)(first, last, predicate, predicate_ctx) == last;
+}
+
+
+ALGDEF int NS(all_of)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+    return NS(find_if_not)(first, last, predicate, predicate_ctx) == last;
+}
+
+ALGDEF size_t NS(count_if)(
+        const T* first,
+        const T* last,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+
+    size_t count = 0;
+    while (first != last) {
+        if (predicate(first, predicate_ctx)) ++count;
+        ++first;
+    }
+    return count;
+}
+
+ALGDEF void NS(mismatch)(
+        const T **first_1,
+        const T *last_1,
+        const T **first_2,
+        int (*compare)(const T*, const T*, void*),
+        void* compare_ctx
+        ) {
+
+    const T* f1 = *first_1;
+    const T* f2 = *first_2;
+    while (f1 != last_1) {
+        if (compare(f1, f2, compare_ctx) != 0) {
+            break;
+        } 
+        ++f1;
+        ++f2;
+    }
+    *first_1 = f1;
+    *first_2 = f2;
+}
+
+ALGDEF T *NS(adjacent_find)(
+        const T *first,
+        const T *last,
+        int (*compare)(const T*, const T*, void*),
+        void* compare_ctx
+        ) {
+
+    if (first != last)
+    {
+        const T* prev = first;
+        const T* next = prev;
+        ++next;
+
+        while (next != last) {
+            if (compare(prev, next, compare_ctx) == 0) {
+                return (T*)prev;
+            }
+            prev = next;
+            ++next;
+        }
+    }
+
+    return (T*)last;
+}
+
+ALGDEF T *NS(copy)(
+        const T *first,
+        const T *last,
+        T *out
+        ) {
+    size_t n = (last - first);
+    memcpy(out, first, n * sizeof(T));
+    return out + n; 
+}
+
+ALGDEF T *NS(copy_n)(
+        const T *first,
+        size_t n,
+        T *out
+        ) {
+    memcpy(out, first, n * sizeof(T));
+    return out + n;
+}
+
+
+ALGDEF T *NS(copy_if)(
+        const T *first,
+        const T *last,
+        T *out,
+        int (*predicate)(const T*,  void*),
+        void* predicate_ctx
+        ) {
+#if defined(ARRAY_ALG_COMPACT_LANES)
+    // Packing a block at a time avoids a mispredicted branch per element.
+    if (ARRAY_ALG_COMPACT_LANES != 0) {
+        const size_t lanes = ARRAY_ALG_COMPACT_LANES;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            unsigned mask = 0;
+            for (size_t j = 0; j < lanes; ++j) mask |= (unsigned)(predicate(first + j, predicate_ctx) != 0) << j;
+            out += NS(_compact)(first, mask, out);
+        }
+    }
+#endif
+
+    while (first != last) {
+        if (predicate(first, predicate_ctx)) {
+            *out = *first;
+            ++out;
+        }
+        ++first;
+    }
+    return out;
+}
+
+ALGDEF T *NS(copy_backward)(
+        const T *first,
+        const T *last,
+        T *last_out
+        ) {
+    size_t n = (last - first);
+    memmove(last_out - n, first, n * sizeof(T));
+    return last_out - n;
+}
+
+ALGDEF int NS(lexicographical_compare)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+#if defined(ARRAY_ALG_BYTEWISE_ORDER)
+    (void)cmp;
+    (void)cmp_ctx;
+    size_t n_1 = last_1 - first_1;
+    size_t n_2 = last_2 - first_2;
+    int result = memcmp(first_1, first_2, (n_1 < n_2 ? n_1 : n_2) * sizeof(T));
+    if (result != 0) return result;
+    return (n_1 > n_2) - (n_1 < n_2);
+#else
+    while (1) {
+        if (first_1 == last_1 && first_2 == last_2) {
+            return 0;
+        } else if (first_1 == last_1) {
+            return -1;
+        } else if (first_2 == last_2) {
+            return 1;
+        }
+
+        int result = cmp(first_1, first_2, cmp_ctx);
+        if (result != 0) return result;
+
+        ++first_1;
+        ++first_2;
+    }
+#endif
+}
+
+ALGDEF int NS(equal)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+#if defined(ARRAY_ALG_BYTEWISE_EQ) || defined(ARRAY_ALG_BYTEWISE_ORDER)
+    (void)cmp;
+    (void)cmp_ctx;
+    return memcmp(first_1, first_2, (last_1 - first_1) * sizeof(T)) == 0;
+#else
+    while (first_1 != last_1) {
+        int result = cmp(first_1, first_2, cmp_ctx);
+        if (result != 0) return 0;
+
+        ++first_1;
+        ++first_2;
+    }
+    return 1;
+#endif
+}
+
+ALGDEF void NS(swap)(T *a, T *b) {
+    T temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+ALGDEF T *NS(swap_ranges)(
+        T *first_1,
+        T *last_1,
+        T *first_2
+        ) {
+    // Swap blocks of bytes through a small buffer, which memcpy moves a vector at a time.
+    unsigned char buffer[256];
+    unsigned char *a = (unsigned char*)first_1;
+    unsigned char *b = (unsigned char*)first_2;
+    size_t bytes = (last_1 - first_1) * sizeof(T);
+
+    while (bytes != 0) {
+        size_t block = bytes < sizeof(buffer) ? bytes : sizeof(buffer);
+        memcpy(buffer, a, block);
+        memcpy(a, b, block);
+        memcpy(b, buffer, block);
+        a += block;
+        b += block;
+        bytes -= block;
+    }
+    return first_2 + (last_1 - first_1);
+}
+
+ALGDEF void NS(reverse)(
+        T *first,
+        T *last
+        ) {
+    if (first == last) return;
+
+    --last;
+    while (first < last) {
+        NS(swap)(first, last);
+        ++first;
+        --last;
+    }
+}
+
+ALGDEF T *NS(reverse_copy)(
+        const T *restrict first,
+        const T *restrict last,
+        T *out
+        ) {
+    // Indexing from both ends lets the compiler vectorize with a shuffle.
+    size_t n = (last - first);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = last[-1 - (ptrdiff_t)i];
+    }
+    return out + n;
+}
+
+ALGDEF T *NS(merge)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+
+    if (first_2 == last_2) {
+        return NS(copy)(first_1, last_1, out);
+    } else if (first_1 == last_1) {
+        return NS(copy)(first_2, last_2, out);
+    }
+
+    while (1) {
+        if (compare(first_1, first_2, compare_ctx) >= 0) {
+            *out = *first_2;
+            ++out;
+            ++first_2;
+
+            if (first_2 == last_2) {
+                return NS(copy)(first_1, last_1, out);
+            }
+        } else {
+            *out = *first_1;
+            ++out;
+            ++first_1;
+
+            if (first_1 == last_1) {
+                return NS(copy)(first_2, last_2, out);
+            }
+        }
+    }
+}
+
+ALGDEF T *NS(merge_branchless)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    while (first_1 != last_1 && first_2 != last_2) {
+        int take_2 = compare(first_1, first_2, compare_ctx) >= 0;
+        const T *next = take_2 ? first_2 : first_1;
+        *out = *next;
+        ++out;
+        first_1 += !take_2;
+        first_2 += take_2;
+    }
+
+    out = NS(copy)(first_1, last_1, out);
+    return NS(copy)(first_2, last_2, out);
+}
+
+ALGDEF T *NS(merge_bidirectional)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    T *out_last = out + (last_1 - first_1) + (last_2 - first_2);
+    T *result = out_last;
+
+    while (first_1 != last_1 && first_2 != last_2) {
+        int take_2 = compare(first_1, first_2, compare_ctx) >= 0;
+        const T *next = take_2 ? first_2 : first_1;
+        *out = *next;
+        ++out;
+        first_1 += !take_2;
+        first_2 += take_2;
+
+        if (first_1 == last_1 || first_2 == last_2) break;
+
+        // Range 1 comes last among equal elements.
+        int take_1 = compare(last_1 - 1, last_2 - 1, compare_ctx) >= 0;
+        const T *prev = take_1 ? last_1 - 1 : last_2 - 1;
+        --out_last;
+        *out_last = *prev;
+        last_1 -= take_1;
+        last_2 -= !take_1;
+    }
+
+    out = NS(copy)(first_1, last_1, out);
+    NS(copy)(first_2, last_2, out);
+    return result;
+}
+
+ALGDEF void NS(merge_with_buffer)(
+        T *first,
+        T *middle,
+        T *last,
+        T *buffer,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        )  {
+    T* buffer_last = NS(copy)(first, middle, buffer);
+    NS(merge)(buffer, buffer_last, middle, last, first, compare, compare_ctx);
+}
+
+ALGDEF size_t NS(merge_path)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        size_t diagonal,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    size_t n_1 = last_1 - first_1;
+    size_t n_2 = last_2 - first_2;
+    size_t low = diagonal > n_2 ? diagonal - n_2 : 0;
+    size_t high = diagonal < n_1 ? diagonal : n_1;
+
+    // Merge takes from range 2 on ties, so first_1[i] is written before
+    // first_2[diagonal - i - 1] only if it is less.
+    while (low < high) {
+        size_t i = low + ((high - low) >> 1);
+        if (compare(first_1 + i, first_2 + (diagonal - i - 1), compare_ctx) < 0) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+ALGDEF T *NS(remove_if)(
+        T *first,
+        T *last,
+        int (*pred)(const T*, void*),
+        void *pred_ctx
+        ) {
+    if (first == last) return first;
+
+    T *out = first;
+
+#if defined(ARRAY_ALG_COMPACT_LANES)
+    if (ARRAY_ALG_COMPACT_LANES != 0) {
+        const size_t lanes = ARRAY_ALG_COMPACT_LANES;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            unsigned mask = 0;
+            for (size_t j = 0; j < lanes; ++j) mask |= (unsigned)(pred(first + j, pred_ctx) == 0) << j;
+            out += NS(_compact)(first, mask, out);
+        }
+    }
+#endif
+
+    while (first != last) {
+        if (!pred(first, pred_ctx)) {
+            *out = *first;
+            ++out;
+        }
+        ++first;
+    }
+    return out;
+}
+
+ALGDEF T *NS(remove_if_not)(
+        T *first,
+        T *last,
+        int (*pred)(const T*, void*),
+        void *pred_ctx
+        ) {
+    if (first == last) return first;
+
+    T *out = first;
+
+    while (first != last) {
+        if (pred(first, pred_ctx)) {
+            *out = *first;
+            ++out;
+        }
+        ++first;
+    }
+    return out;
+}
+
+
+ALGDEF T *NS(replace_if)(
+        T *first,
+        T *last,
+        const T *replacement,
+        int (*pred)(const T*, void*),
+        void *pred_ctx
+        ) {
+    while (first != last) {
+        if (pred(first, pred_ctx)) {
+            *first = *replacement;
+        }
+        ++first;
+    }
+    return first;
+}
+
+ALGDEF T *NS(unique)(
+        T *first,
+        T *last,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (first == last) return first;
+
+    T *out = first;
+    ++first;
+
+#if defined(ARRAY_ALG_COMPACT_LANES)
+    if (ARRAY_ALG_COMPACT_LANES != 0) {
+        // Compare each element with the one before it instead of the last one kept.
+        // Elements are only written at or before where they were read,
+        // so the one before the block is unchanged.
+        const size_t lanes = ARRAY_ALG_COMPACT_LANES;
+        ++out;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            unsigned mask = 0;
+            for (size_t j = 0; j < lanes; ++j) mask |= (unsigned)(cmp(first + j - 1, first + j, cmp_ctx) != 0) << j;
+            out += NS(_compact)(first, mask, out);
+        }
+        --out;
+    }
+#endif
+
+    while (first != last) {
+        if (cmp(out, first, cmp_ctx) != 0) {
+            ++out;
+            *out = *first;
+        }
+        ++first;
+    }
+    ++out;
+    return out;
+}
+
+ALGDEF T *NS(unique_copy)(
+        T *restrict first,
+        T *last,
+        T *restrict out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (first == last) return out;
+
+    *out = *first;
+
+    while (first != last) {
+        if (cmp(out, first, cmp_ctx) != 0) {
+            ++out;
+            *out = *first;
+        }
+        ++first;
+    }
+    ++out;
+    return out;
+}
+
+/// Whether every byte of x is the same, so filling with it is a memset.
+static int NS(_is_byte_pattern)(
+        const T *x
+        ) {
+    const unsigned char *bytes = (const unsigned char*)x;
+    for (size_t i = 1; i < sizeof(T); ++i) {
+        if (bytes[i] != bytes[0]) return 0;
+    }
+    return 1;
+}
+
+ALGDEF T *NS(fill)(
+        T *first,
+        T *last,
+        const T *x
+        ) {
+    return NS(fill_n)(first, last - first, x);
+}
+
+ALGDEF T *NS(fill_n)(
+        T *first,
+        size_t count,
+        const T *x
+        ) {
+    if (NS(_is_byte_pattern)(x)) {
+        memset(first, *(const unsigned char*)x, count * sizeof(T));
+        return first + count;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        first[i] = *x;
+    }
+    return first + count;
+}
+
+ALGDEF int NS(set_includes)(
+        const T *first_sub,
+        const T *last_sub,
+        const T *first_super,
+        const T *last_super,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+
+    if (first_sub == last_sub) return 1;
+
+    size_t n_sub = last_sub - first_sub;
+    size_t n_super = last_super - first_super;
+    // Each element of sub must match a different element of super.
+    if (n_sub > n_super) return 0;
+
+    if (n_super / ARRAY_ALG_GALLOP_RATIO >= n_sub) {
+        while (first_sub != last_sub) {
+            first_super = NS(lower_bound_hint)(first_super, last_super, first_super, first_sub, cmp, cmp_ctx);
+            if (first_super == last_super || cmp(first_sub, first_super, cmp_ctx) != 0) return 0;
+            ++first_super;
+            ++first_sub;
+        }
+        return 1;
+    }
+
+    while (first_super != last_super) {
+        int result = cmp(first_sub, first_super, cmp_ctx);
+        if (result < 0) {
+            return 0;
+        } else if (result == 0) {
+            ++first_sub;
+            if (first_sub == last_sub) return 1;
+        }
+        ++first_super;
+    }
+    return 0;
+}
+
+
+ALGDEF T *NS(set_union)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    while (1) {
+        if (first_1 == last_1) {
+            return NS(copy)(first_2, last_2, out);
+        } else if (first_2 == last_2) {
+            return NS(copy)(first_1, last_1, out);
+        }
+
+        int result = cmp(first_1, first_2, cmp_ctx);
+        if (result == 0) {
+            *out = *first_1;
+            ++first_1;
+            ++first_2;
+        } else if (result >= 0) {
+            *out = *first_2;
+            ++first_2;
+        } else {
+            *out = *first_1;
+            ++first_1;
+        }
+        ++out;
+    }
+}
+
+ALGDEF T *NS(set_difference)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (first_1 == last_1) return out;
+
+    size_t n_1 = last_1 - first_1;
+    size_t n_2 = last_2 - first_2;
+
+    if (n_1 / ARRAY_ALG_GALLOP_RATIO >= n_2) {
+        // Copy the runs of range 1 between elements of range 2.
+        // out may equal first_1, so the runs can overlap.
+        while (first_2 != last_2) {
+            const T *run = first_1;
+            first_1 = NS(lower_bound_hint)(first_1, last_1, first_1, first_2, cmp, cmp_ctx);
+            memmove(out, run, (first_1 - run) * sizeof(T));
+            out += first_1 - run;
+            if (first_1 == last_1) return out;
+            if (cmp(first_1, first_2, cmp_ctx) == 0) ++first_1;
+            ++first_2;
+        }
+        memmove(out, first_1, (last_1 - first_1) * sizeof(T));
+        return out + (last_1 - first_1);
+    } else if (n_2 / ARRAY_ALG_GALLOP_RATIO >= n_1) {
+        while (first_1 != last_1) {
+            first_2 = NS(lower_bound_hint)(first_2, last_2, first_2, first_1, cmp, cmp_ctx);
+            if (first_2 != last_2 && cmp(first_1, first_2, cmp_ctx) == 0) {
+                ++first_2;
+            } else {
+                if (out != first_1) *out = *first_1;
+                ++out;
+            }
+            ++first_1;
+        }
+        return out;
+    }
+
+    while (1) {
+        int result = cmp(first_1, first_2, cmp_ctx);
+        if (result == 0) {
+            ++first_1;
+            ++first_2;
+            if (first_1 == last_1) return out;
+            if (first_2 == last_2) {
+                memmove(out, first_1, (last_1 - first_1) * sizeof(T));
+                return out + (last_1 - first_1);
+            }
+        } else if (result < 0) {
+            if (out != first_1) *out = *first_1;
+            ++first_1;
+            ++out;
+            if (first_1 == last_1) return out;
+        } else if (result > 0) {
+            ++first_2;
+            if (first_2 == last_2) {
+                memmove(out, first_1, (last_1 - first_1) * sizeof(T));
+                return out + (last_1 - first_1);
+            }
+        }
+    }
+}
+
+/// Shared by set_intersection and the set size functions.
+/// Writes the matches to out, unless it is NULL, and returns how many there are.
+static size_t NS(_set_intersection)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t count = 0;
+    if (first_1 == last_1 || first_2 == last_2) return count;
+
+    size_t n_1 = last_1 - first_1;
+    size_t n_2 = last_2 - first_2;
+
+    if (n_1 / ARRAY_ALG_GALLOP_RATIO >= n_2) {
+        while (first_2 != last_2) {
+            first_1 = NS(lower_bound_hint)(first_1, last_1, first_1, first_2, cmp, cmp_ctx);
+            if (first_1 == last_1) return count;
+            if (cmp(first_1, first_2, cmp_ctx) == 0) {
+                if (out) out[count] = *first_1;
+                ++count;
+                ++first_1;
+            }
+            ++first_2;
+        }
+        return count;
+    } else if (n_2 / ARRAY_ALG_GALLOP_RATIO >= n_1) {
+        while (first_1 != last_1) {
+            first_2 = NS(lower_bound_hint)(first_2, last_2, first_2, first_1, cmp, cmp_ctx);
+            if (first_2 == last_2) return count;
+            if (cmp(first_1, first_2, cmp_ctx) == 0) {
+                if (out) out[count] = *first_1;
+                ++count;
+                ++first_2;
+            }
+            ++first_1;
+        }
+        return count;
+    }
+
+    while (1) {
+        int result = cmp(first_1, first_2, cmp_ctx);
+        if (result == 0) {
+            if (out) out[count] = *first_1;
+            ++count;
+            ++first_1;
+            ++first_2;
+            if (first_1 == last_1 || first_2 == last_2) return count;
+        } else if (result < 0) {
+            ++first_1;
+            if (first_1 == last_1) return count;
+        } else if (result > 0) {
+            ++first_2;
+            if (first_2 == last_2) return count;
+        }
+    }
+}
+
+ALGDEF T *NS(set_intersection)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    return out + NS(_set_intersection)(first_1, last_1, first_2, last_2, out, cmp, cmp_ctx);
+}
+
+ALGDEF size_t NS(set_intersection_size)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    return NS(_set_intersection)(first_1, last_1, first_2, last_2, NULL, cmp, cmp_ctx);
+}
+
+ALGDEF size_t NS(set_union_size)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t shared = NS(_set_intersection)(first_1, last_1, first_2, last_2, NULL, cmp, cmp_ctx);
+    return (last_1 - first_1) + (last_2 - first_2) - shared;
+}
+
+ALGDEF size_t NS(set_difference_size)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t shared = NS(_set_intersection)(first_1, last_1, first_2, last_2, NULL, cmp, cmp_ctx);
+    return (last_1 - first_1) - shared;
+}
+
+ALGDEF void NS(set_stats)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        size_t *intersection_size,
+        size_t *union_size,
+        size_t *difference_size,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t shared = NS(_set_intersection)(first_1, last_1, first_2, last_2, NULL, cmp, cmp_ctx);
+    *intersection_size = shared;
+    *union_size = (last_1 - first_1) + (last_2 - first_2) - shared;
+    *difference_size = (last_1 - first_1) - shared;
+}
+
+ALGDEF T *NS(set_intersection_k)(
+        const T **firsts,
+        const T **lasts,
+        size_t k,
+        T *restrict out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (k == 0) return out;
+
+    size_t *order = malloc(k * sizeof(size_t));
+    const T **cursors = malloc(k * sizeof(const T*));
+    if (!order || !cursors) {
+        free(order);
+        free(cursors);
+        return NULL;
+    }
+
+    // Insertion sort the ranges by size.
+    for (size_t i = 0; i < k; ++i) {
+        size_t j = i;
+        while (j > 0 && lasts[order[j - 1]] - firsts[order[j - 1]] > lasts[i] - firsts[i]) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+        cursors[i] = firsts[i];
+    }
+
+    const T **smallest = cursors + order[0];
+    const T *smallest_last = lasts[order[0]];
+
+    while (*smallest != smallest_last) {
+        size_t i = 1;
+        while (i < k) {
+            size_t r = order[i];
+            cursors[r] = NS(lower_bound_hint)(cursors[r], lasts[r], cursors[r], *smallest, cmp, cmp_ctx);
+            if (cursors[r] == lasts[r]) break;
+
+            if (cmp(cursors[r], *smallest, cmp_ctx) != 0) {
+                // Skip the candidates which range r has ruled out, and start over.
+                *smallest = NS(lower_bound_hint)(*smallest, smallest_last, *smallest, cursors[r], cmp, cmp_ctx);
+                if (*smallest == smallest_last) break;
+                i = 1;
+            } else {
+                ++i;
+            }
+        }
+        // Leaving before every range matched means one of them ran out.
+        if (i < k) break;
+
+        *out = **smallest;
+        ++out;
+        for (i = 0; i < k; ++i) ++cursors[i];
+    }
+
+    free(order);
+    free(cursors);
+    return out;
+}
+
+/// Restore the heap below i, ordered by the head of each range.
+static void NS(_set_union_k_sift_down)(
+        size_t *heap,
+        size_t n,
+        size_t i,
+        const T **cursors,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t top = heap[i];
+    while (1) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && cmp(cursors[heap[child + 1]], cursors[heap[child]], cmp_ctx) < 0) ++child;
+        if (cmp(cursors[heap[child]], cursors[top], cmp_ctx) >= 0) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = top;
+}
+
+ALGDEF T *NS(set_union_k)(
+        const T **firsts,
+        const T **lasts,
+        size_t k,
+        T *restrict out,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t *heap = malloc(k * sizeof(size_t));
+    const T **cursors = malloc(k * sizeof(const T*));
+    if (k && (!heap || !cursors)) {
+        free(heap);
+        free(cursors);
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < k; ++i) {
+        cursors[i] = firsts[i];
+        if (firsts[i] != lasts[i]) heap[n++] = i;
+    }
+    for (size_t i = n / 2; i-- > 0;) {
+        NS(_set_union_k_sift_down)(heap, n, i, cursors, cmp, cmp_ctx);
+    }
+
+    while (n > 0) {
+        const T *value = cursors[heap[0]];
+
+        // Consume the run of value from each range which starts with it,
+        // and keep the longest.
+        size_t longest = 0;
+        while (n > 0 && cmp(cursors[heap[0]], value, cmp_ctx) == 0) {
+            size_t r = heap[0];
+            const T *run = cursors[r];
+            while (cursors[r] != lasts[r] && cmp(cursors[r], value, cmp_ctx) == 0) ++cursors[r];
+            if ((size_t)(cursors[r] - run) > longest) {
+                longest = cursors[r] - run;
+                value = cursors[r] - 1;
+            }
+
+            if (cursors[r] == lasts[r]) heap[0] = heap[--n];
+            NS(_set_union_k_sift_down)(heap, n, 0, cursors, cmp, cmp_ctx);
+        }
+
+        // The run ends at value, so copy it from there.
+        out = NS(copy)(value - longest + 1, value + 1, out);
+    }
+
+    free(heap);
+    free(cursors);
+    return out;
+}
+
+ALGDEF T *NS(min)(
+        const T* a,
+        const T* b,
+        int (*cmp)(const T*, const T*, void*),
+        void* ctx
+        ) {
+    if (cmp(b, a, ctx) < 0) {
+        return (T*)b;
+    } else {
+        return (T*)a;
+    }
+}
+
+ALGDEF T *NS(max)(
+        const T *a,
+        const T *b,
+        int (*cmp)(const T*, const T*, void*),
+        void* ctx
+        ) {
+    if (cmp(a, b, ctx) > 0) {
+        return (T*)a;
+    } else {
+        return (T*)b;
+    }
+}
+
+ALGDEF T *NS(min_element)(
+        const T *first,
+        const T *last,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (first == last) return (T*)last;
+
+    const T* best = first;
+    ++first;
+
+    while (first != last) {
+        if (cmp(first, best, cmp_ctx) < 0) {
+            best = first;
+        }
+        ++first;
+    }
+    return (T*)best;
+}
+
+ALGDEF T *NS(max_element)(
+        const T *first,
+        const T *last,
+        int (*cmp)(const T*, const T*, void*),
+        void* ctx
+        ) {
+    if (first == last) return (T*)first;
+
+    const T* best = first;
+    ++first;
+
+    while (first != last) {
+        if (cmp(first, best, ctx) > 0) best = first;
+        ++first;
+    }
+    return (T*)best;
+}
+
+ALGDEF void NS(minmax_element)(
+        const T *first,
+        const T *last,
+        T** out_min,
+        T** out_max,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (first == last) return;
+    const T *min_p = first;
+    ++first;
+
+    if (first == last) {
+        *out_min = (T*)min_p;
+        *out_max = (T*)min_p;
+        return;
+    }
+
+    const T *max_p = first;
+    if (cmp(max_p, min_p, cmp_ctx) < 0) {
+        const T* temp = min_p;
+        min_p = max_p;
+        max_p = temp;
+    }
+
+    ++first;
+
+    while (first != last && first + 1 != last) {
+        const T *potential_min = first;
+        const T *potential_max = first + 1;
+
+        if (cmp(potential_max, potential_min, cmp_ctx) < 0) {
+            const T* temp = potential_min;
+            potential_min = potential_max;
+            potential_max = temp;
+        }
+
+        if (cmp(potential_min, min_p, cmp_ctx) < 0) {
+            min_p = potential_min;
+        }
+
+        if (cmp(potential_max, max_p, cmp_ctx) >= 0) {
+            max_p = potential_max;
+        }
+        ++first;
+        ++first;
+    }
+
+    if (first != last) {
+        if (cmp(first, min_p, cmp_ctx) < 0) {
+            min_p = first;
+        } else if (cmp(first, max_p, cmp_ctx) >= 0) {
+            max_p = first;
+        }
+    }
+    *out_min = (T*)min_p;
+    *out_max = (T*)max_p;
+}
+
+ALGDEF int NS(is_partitioned)(
+        const T *first, 
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        ) {
+    first = NS(find_if_not)(first, last, predicate, predicate_ctx);
+    first = NS(find_if)(first, last, predicate, predicate_ctx);
+    return first == last;
+}
+
+ALGDEF T *NS(partition)(
+        T *first,
+        T *last,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        )
+{
+    T* out = first;
+
+    while (first != last)
+    {
+        if (predicate(first, predicate_ctx))
+        {
+            NS(swap)(out, first);
+            ++out;
+        }
+        ++first;
+    }
+    return out;
+}
+
+ALGDEF T *NS(stable_partition_with_buffer)(
+        T *first,
+        T *last,
+        T *buffer,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        )
+{
+    T *out_false = buffer;
+    T *out_true = first;
+    NS(partition_copy)(first, last, &out_true, &out_false, predicate, predicate_ctx);
+    memcpy(out_true, buffer, sizeof(T) * (out_false - buffer));
+    return out_true;
+}
+
+ALGDEF T *NS(stable_partition)(
+        T *first,
+        T *last,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        )
+{
+    // TODO: this is not the best implementation 
+    if (first == last) return last;
+    T *buffer = malloc((last - first) * sizeof(T));
+    T *point = NS(stable_partition_with_buffer)(first, last, buffer, predicate, predicate_ctx);
+    free(buffer);
+    return point;
+}
+
+ALGDEF void NS(partition_copy)(
+        const T *first,
+        const T *last,
+        T **out_true,
+        T **out_false,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        ) {
+
+    while (first != last)
+    {
+        if (predicate(first, predicate_ctx))
+        {
+            *(*out_true) = *first;
+            ++(*out_true);
+        }
+        else
+        {
+            *(*out_false) = *first;
+            ++(*out_false);
+        }
+        ++first;
+    }
+}
+
+
+ALGDEF T *NS(partition_point_n)(
+        const T *first,
+        size_t n,
+        int (*predicate)(const T*, void*),
+        void* predicate_ctx
+        ) {
+    while (n) {
+        size_t half = n >> 1;
+        const T* middle = first + half;
+
+        if (predicate(middle, predicate_ctx)) {
+            ++middle;
+            first = middle;
+            n -= (half + 1);
+        } else {
+            n = half;
+        }
+    }
+    return (T*)first;
+}
+
+ALGDEF T *NS(partition_point)(
+        const T *first,
+        const T *last,
+        int (*predicate)(const T*, void*),
+        void *predicate_ctx
+        ) {
+    return NS(partition_point_n)(first, last - first, predicate, predicate_ctx);
+}
+
+ALGDEF T *NS(is_sorted_until)(
+        const T* first,
+        const T* last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    if (first != last)
+    {
+        const T* prev = first;
+        const T* next = prev;
+        ++next;
+
+        while (next != last)
+        {
+            if (compare(prev, next, compare_ctx) > 0) return (T*)next;
+            prev = next;
+            ++next;
+        }
+    }
+    return (T*)last;
+}
+
+ALGDEF int NS(is_sorted)(
+        const T *first,
+        const T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    return NS(is_sorted_until)(first, last, compare, compare_ctx) == last;
+}
+
+/// Branchless binary search: the midpoint update compiles to a conditional move,
+/// and both possible next midpoints are prefetched while the comparison runs.
+static T *NS(_lower_bound_n)(
+        const T *first,
+        size_t n,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (n == 0) return (T*)first;
+
+    while (n > 1) {
+        size_t half = n >> 1;
+        n -= half;
+        ARRAY_ALG_PREFETCH(first + (n >> 1));
+        ARRAY_ALG_PREFETCH(first + half + (n >> 1));
+        first += (cmp(first + half, value, cmp_ctx) < 0) * half;
+    }
+    return (T*)first + (cmp(first, value, cmp_ctx) < 0);
+}
+
+static T *NS(_upper_bound_n)(
+        const T *first,
+        size_t n,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    if (n == 0) return (T*)first;
+
+    while (n > 1) {
+        size_t half = n >> 1;
+        n -= half;
+        ARRAY_ALG_PREFETCH(first + (n >> 1));
+        ARRAY_ALG_PREFETCH(first + half + (n >> 1));
+        first += (cmp(value, first + half, cmp_ctx) >= 0) * half;
+    }
+    return (T*)first + (cmp(value, first, cmp_ctx) >= 0);
+}
+
+ALGDEF T *NS(lower_bound)(
+        const T *first,
+        const T *last,
+        const T* value,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    return NS(_lower_bound_n)(first, last - first, value, cmp, cmp_ctx);
+}
+
+ALGDEF T *NS(upper_bound)(
+        const T *first,
+        const T *last,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    return NS(_upper_bound_n)(first, last - first, value, cmp, cmp_ctx);
+}
+
+ALGDEF int NS(binary_search)(
+        const T *first,
+        const T *last,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    first = NS(lower_bound)(first, last, value, cmp, cmp_ctx);
+    return (first != last) && cmp(first, value, cmp_ctx) == 0;
+}
+
+ALGDEF void NS(equal_range)(
+        const T *first,
+        const T *last,
+        const T *value,
+        T **lower,
+        T **upper,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    size_t n = last - first;
+    while (n > 0) {
+        size_t half = n >> 1;
+        const T *middle = first + half;
+        int c = cmp(middle, value, cmp_ctx);
+        if (c < 0) {
+            first = middle + 1;
+            n -= half + 1;
+        } else if (c > 0) {
+            n = half;
+        } else {
+            // Everything before first is less and everything after first + n is greater,
+            // so each bound is confined to one side of middle.
+            *lower = NS(_lower_bound_n)(first, half, value, cmp, cmp_ctx);
+            *upper = NS(_upper_bound_n)(middle + 1, n - half - 1, value, cmp, cmp_ctx);
+            return;
+        }
+    }
+    *lower = (T*)first;
+    *upper = (T*)first;
+}
+
+ALGDEF size_t NS(count_equal)(
+        const T *first,
+        const T *last,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    T *lower;
+    T *upper;
+    NS(equal_range)(first, last, value, &lower, &upper, cmp, cmp_ctx);
+    return upper - lower;
+}
+
+ALGDEF T *NS(lower_bound_hint)(
+        const T *first,
+        const T *last,
+        const T *hint,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    size_t step = 1;
+
+    if (hint != last && cmp(hint, value, cmp_ctx) < 0) {
+        // Everything up to hint is less than value, gallop forward.
+        first = hint + 1;
+        size_t n = last - first;
+        while (step <= n && cmp(first + step - 1, value, cmp_ctx) < 0) {
+            first += step;
+            n -= step;
+            step <<= 1;
+        }
+        return NS(_lower_bound_n)(first, step <= n ? step - 1 : n, value, cmp, cmp_ctx);
+    } else {
+        // Everything from hint on is not less than value, gallop backward.
+        size_t n = hint - first;
+        while (step <= n && cmp(hint - step, value, cmp_ctx) >= 0) {
+            hint -= step;
+            n -= step;
+            step <<= 1;
+        }
+        if (step <= n) first = hint - step + 1;
+        return NS(_lower_bound_n)(first, hint - first, value, cmp, cmp_ctx);
+    }
+}
+
+ALGDEF T *NS(upper_bound_hint)(
+        const T *first,
+        const T *last,
+        const T *hint,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    size_t step = 1;
+
+    if (hint != last && cmp(value, hint, cmp_ctx) >= 0) {
+        first = hint + 1;
+        size_t n = last - first;
+        while (step <= n && cmp(value, first + step - 1, cmp_ctx) >= 0) {
+            first += step;
+            n -= step;
+            step <<= 1;
+        }
+        return NS(_upper_bound_n)(first, step <= n ? step - 1 : n, value, cmp, cmp_ctx);
+    } else {
+        size_t n = hint - first;
+        while (step <= n && cmp(value, hint - step, cmp_ctx) < 0) {
+            hint -= step;
+            n -= step;
+            step <<= 1;
+        }
+        if (step <= n) first = hint - step + 1;
+        return NS(_upper_bound_n)(first, hint - first, value, cmp, cmp_ctx);
+    }
+}
+
+ALGDEF void NS(lower_bound_batch)(
+        const T *first,
+        const T *last,
+        const T *queries,
+        size_t query_count,
+        size_t *out_positions,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    enum { GROUP = 16 };
+    size_t n = last - first;
+
+    if (n == 0) {
+        for (size_t i = 0; i < query_count; ++i) out_positions[i] = 0;
+        return;
+    }
+
+    const T *bases[GROUP];
+
+    for (size_t q = 0; q < query_count; q += GROUP) {
+        size_t group = query_count - q < GROUP ? query_count - q : GROUP;
+        const T *group_queries = queries + q;
+
+        for (size_t i = 0; i < group; ++i) bases[i] = first;
+
+        // Same steps as lower_bound, but one level for each search in the group at a time,
+        // so the next midpoint of each search is loading while the others compare.
+        size_t len = n;
+        while (len > 1) {
+            size_t half = len >> 1;
+            len -= half;
+            for (size_t i = 0; i < group; ++i) {
+                bases[i] += (cmp(bases[i] + half, group_queries + i, cmp_ctx) < 0) * half;
+                ARRAY_ALG_PREFETCH(bases[i] + (len >> 1));
+            }
+        }
+
+        for (size_t i = 0; i < group; ++i) {
+            out_positions[q + i] = (bases[i] - first) + (cmp(bases[i], group_queries + i, cmp_ctx) < 0);
+        }
+    }
+}
+
+ALGDEF void NS(lower_bound_batch_sorted)(
+        const T *first,
+        const T *last,
+        const T *queries,
+        size_t query_count,
+        size_t *out_positions,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    const T *position = first;
+    for (size_t i = 0; i < query_count; ++i) {
+        position = NS(lower_bound_hint)(first, last, position, queries + i, cmp, cmp_ctx);
+        out_positions[i] = position - first;
+    }
+}
+
+/// An element of a cascade level with its links:
+/// the number of elements of array i before it and its lower_bound in level i + 1.
+typedef struct {
+    T value;
+    uint32_t own;
+    uint32_t next;
+} NS(_cascade_node);
+
+ALGDEF int NS(cascade_build)(
+        array_alg_cascade *cascade,
+        const T **firsts,
+        const T **lasts,
+        size_t k,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    cascade->k = k;
+    cascade->nodes = NULL;
+    cascade->offsets = malloc((k + 1) * sizeof(size_t));
+    if (!cascade->offsets) return 0;
+
+    size_t *offsets = cascade->offsets;
+
+    // Level sizes depend on the level below, so find them from the back.
+    size_t promoted = 0;
+    for (size_t i = k; i-- > 0;) {
+        offsets[i] = (lasts[i] - firsts[i]) + promoted;
+        promoted = offsets[i] / 2;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < k; ++i) {
+        size_t size = offsets[i];
+        if (size > UINT32_MAX - 1) {
+            NS(cascade_free)(cascade);
+            return 0;
+        }
+        offsets[i] = total;
+        total += size;
+    }
+    offsets[k] = total;
+
+    cascade->nodes = malloc((total + k) * sizeof(NS(_cascade_node)));
+    if (k && !cascade->nodes) {
+        NS(cascade_free)(cascade);
+        return 0;
+    }
+
+    for (size_t i = k; i-- > 0;) {
+        NS(_cascade_node) *level = (NS(_cascade_node)*)cascade->nodes + offsets[i] + i;
+        size_t size = offsets[i + 1] - offsets[i];
+
+        const T *a = firsts[i];
+        const NS(_cascade_node) *next = level + size + 1;
+        size_t next_size = i + 1 < k ? offsets[i + 2] - offsets[i + 1] : 0;
+        size_t b = 1;
+
+        // Merge array i with the odd positions of the next level,
+        // recording how many elements of array i come before each position.
+        for (size_t j = 0; j < size; ++j) {
+            level[j].own = (uint32_t)(a - firsts[i]);
+            if (b < next_size && (a == lasts[i] || cmp(&next[b].value, a, cmp_ctx) < 0)) {
+                level[j].value = next[b].value;
+                b += 2;
+            } else {
+                level[j].value = *a;
+                ++a;
+            }
+        }
+        level[size].own = (uint32_t)(a - firsts[i]);
+
+        // Link each element to its lower_bound in the next level.
+        size_t q = 0;
+        for (size_t j = 0; j < size; ++j) {
+            while (q < next_size && cmp(&next[q].value, &level[j].value, cmp_ctx) < 0) ++q;
+            level[j].next = (uint32_t)q;
+        }
+        level[size].next = (uint32_t)next_size;
+    }
+    return 1;
+}
+
+ALGDEF void NS(cascade_free)(
+        array_alg_cascade *cascade
+        ) {
+    free(cascade->nodes);
+    free(cascade->offsets);
+}
+
+ALGDEF void NS(cascade_lower_bound)(
+        const array_alg_cascade *cascade,
+        const T *value,
+        size_t *out_positions,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    const size_t *offsets = cascade->offsets;
+    size_t k = cascade->k;
+    if (k == 0) return;
+
+    // Binary search level 0 like _lower_bound_n, striding over the links.
+    const NS(_cascade_node) *level = cascade->nodes;
+    size_t p = 0;
+    size_t n = offsets[1];
+    if (n > 0) {
+        while (n > 1) {
+            size_t half = n >> 1;
+            n -= half;
+            ARRAY_ALG_PREFETCH(level + p + (n >> 1));
+            ARRAY_ALG_PREFETCH(level + p + half + (n >> 1));
+            p += (cmp(&level[p + half].value, value, cmp_ctx) < 0) * half;
+        }
+        p += cmp(&level[p].value, value, cmp_ctx) < 0;
+    }
+
+    for (size_t i = 0; i < k; ++i) {
+        out_positions[i] = level[p].own;
+
+        if (i + 1 < k) {
+            // Every second element of the next level is in this one,
+            // so the lower_bound there is at most a step or two before the link.
+            p = level[p].next;
+            level += offsets[i + 1] - offsets[i] + 1;
+            while (p != 0 && cmp(&level[p - 1].value, value, cmp_ctx) >= 0) --p;
+        }
+    }
+}
+
+/// Fill the subtree rooted at k from an in order walk of the sorted array.
+static const T *NS(_eytzinger_build)(
+        const T *sorted,
+        T *out,
+        size_t k,
+        size_t n
+        ) {
+    if (k > n) return sorted;
+
+    sorted = NS(_eytzinger_build)(sorted, out, 2 * k, n);
+    out[k] = *sorted;
+    ++sorted;
+    return NS(_eytzinger_build)(sorted, out, 2 * k + 1, n);
+}
+
+ALGDEF void NS(eytzinger_build)(
+        const T *sorted_first,
+        const T *sorted_last,
+        T *out
+        ) {
+    NS(_eytzinger_build)(sorted_first, out, 1, sorted_last - sorted_first);
+}
+
+ALGDEF size_t NS(eytzinger_lower_bound)(
+        const T *eytzinger,
+        size_t n,
+        const T *value,
+        int (*cmp)(const T*, const T*, void*),
+        void *cmp_ctx
+        ) {
+    size_t k = 1;
+    while (k <= n) {
+        // The 16 descendants four levels down are contiguous.
+        ARRAY_ALG_PREFETCH(eytzinger + 16 * k);
+        k = 2 * k + (cmp(eytzinger + k, value, cmp_ctx) < 0);
+    }
+
+    // Undo the right turns after the last left turn.
+    k >>= array_alg_count_trailing_zeros(~k) + 1;
+    if (k == 0) return n;
+
+    // In order rank of node k, as if the last level were full,
+    // minus the missing last level nodes which come before it.
+    size_t depth = array_alg_bit_width(n) - 1;
+    size_t last_level_count = n - (((size_t)1 << depth) - 1);
+    size_t k_depth = array_alg_bit_width(k) - 1;
+    size_t k_offset = k - ((size_t)1 << k_depth);
+
+    size_t rank = ((2 * k_offset + 1) << (depth - k_depth)) - 1;
+    size_t last_level_before = (rank + 1) >> 1;
+    if (last_level_before > last_level_count) {
+        rank -= last_level_before - last_level_count;
+    }
+    return rank;
+}
+
+#ifdef ARRAY_ALG_ARITHMETIC
+#ifndef ARRAY_ALG_STREE_
+#define ARRAY_ALG_STREE_
+enum {
+    ARRAY_ALG_STREE_B = 16,
+    ARRAY_ALG_STREE_MAX_LEVELS = 16
+};
+#endif
+
+/// Compute the node count of each level, from the leaves (level 0) up to the root.
+/// The tree starts with a header node holding a copy of the largest key,
+/// then the levels from the root down to the leaves, so every node is a whole number of nodes from the start.
+/// Returns the number of levels.
+static size_t NS(_stree_counts)(
+        size_t n,
+        size_t *counts
+        ) {
+    size_t levels = 1;
+
+    // The divisions are by constants, so they compile to multiplies.
+    counts[0] = (n + ARRAY_ALG_STREE_B - 1) / ARRAY_ALG_STREE_B;
+    while (counts[levels - 1] > 1) {
+        counts[levels] = (counts[levels - 1] + ARRAY_ALG_STREE_B) / (ARRAY_ALG_STREE_B + 1);
+        ++levels;
+    }
+    return levels;
+}
+
+/// Count the keys in a node which are less than x.
+static size_t NS(_stree_node_rank)(
+        const T *node,
+        T x
+        ) {
+    // These branches are constant for a given T.
+    const int is_integer = ((T)0.5 == 0);
+    const int is_signed = ((T)-1 < (T)1);
+
+#if defined(__AVX2__)
+    if (is_integer && sizeof(T) == 4) {
+        int32_t x_bits;
+        memcpy(&x_bits, &x, sizeof(x_bits));
+        __m256i bias = _mm256_set1_epi32(is_signed ? 0 : INT32_MIN);
+        __m256i v = _mm256_xor_si256(_mm256_set1_epi32(x_bits), bias);
+        __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)node), bias);
+        __m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)node + 1), bias);
+        unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, a)))
+            | ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, b))) << 8);
+        return array_alg_popcount(mask);
+    }
+    if (is_integer && sizeof(T) == 8) {
+        int64_t x_bits;
+        memcpy(&x_bits, &x, sizeof(x_bits));
+        __m256i bias = _mm256_set1_epi64x(is_signed ? 0 : INT64_MIN);
+        __m256i v = _mm256_xor_si256(_mm256_set1_epi64x(x_bits), bias);
+        unsigned mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)node + i), bias);
+            mask |= (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, a))) << (4 * i);
+        }
+        return array_alg_popcount(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    if (is_integer && sizeof(T) == 4) {
+        int32_t x_bits;
+        memcpy(&x_bits, &x, sizeof(x_bits));
+        __m128i bias = _mm_set1_epi32(is_signed ? 0 : INT32_MIN);
+        __m128i v = _mm_xor_si128(_mm_set1_epi32(x_bits), bias);
+        unsigned mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)node + i), bias);
+            mask |= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(a, v))) << (4 * i);
+        }
+        return array_alg_popcount(mask);
+    }
+    if (!is_integer && sizeof(T) == 4) {
+        float x_float;
+        memcpy(&x_float, &x, sizeof(x_float));
+        __m128 v = _mm_set1_ps(x_float);
+        unsigned mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            mask |= (unsigned)_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps((const float*)node + 4 * i), v)) << (4 * i);
+        }
+        return array_alg_popcount(mask);
+    }
+    if (!is_integer && sizeof(T) == 8) {
+        double x_double;
+        memcpy(&x_double, &x, sizeof(x_double));
+        __m128d v = _mm_set1_pd(x_double);
+        unsigned mask = 0;
+        for (int i = 0; i < 8; ++i) {
+            mask |= (unsigned)_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd((const double*)node + 2 * i), v)) << (2 * i);
+        }
+        return array_alg_popcount(mask);
+    }
+#endif
+    size_t rank = 0;
+    for (int i = 0; i < ARRAY_ALG_STREE_B; ++i) {
+        rank += node[i] < x;
+    }
+    return rank;
+}
+
+ALGDEF size_t NS(stree_size)(
+        size_t n
+        ) {
+    if (n == 0) return 0;
+    size_t counts[ARRAY_ALG_STREE_MAX_LEVELS];
+    size_t levels = NS(_stree_counts)(n, counts);
+
+    size_t nodes = 1;
+    for (size_t h = 0; h < levels; ++h) nodes += counts[h];
+    return nodes * ARRAY_ALG_STREE_B;
+}
+
+ALGDEF void NS(stree_build)(
+        const T *sorted_first,
+        const T *sorted_last,
+        T *out
+        ) {
+    size_t n = sorted_last - sorted_first;
+    if (n == 0) return;
+
+    size_t counts[ARRAY_ALG_STREE_MAX_LEVELS];
+    size_t offsets[ARRAY_ALG_STREE_MAX_LEVELS];
+    size_t levels = NS(_stree_counts)(n, counts);
+
+    size_t offset = ARRAY_ALG_STREE_B;
+    for (size_t h = levels; h-- > 0;) {
+        offsets[h] = offset;
+        offset += counts[h] * ARRAY_ALG_STREE_B;
+    }
+
+    // Missing keys are padded with the largest key, which is never less than a value we search for.
+    // The rest of the header node is padding too.
+    T max = sorted_first[n - 1];
+    for (size_t i = 0; i < ARRAY_ALG_STREE_B; ++i) out[i] = max;
+
+    T *leaves = out + offsets[0];
+    NS(copy)(sorted_first, sorted_last, leaves);
+    for (T *p = leaves + n; p != leaves + counts[0] * ARRAY_ALG_STREE_B; ++p) *p = max;
+
+    // The first leaf under a node on level h is (node index) * (B + 1)^h.
+    size_t leaves_per_node = 1;
+    for (size_t h = 1; h < levels; ++h) {
+        T *node = out + offsets[h];
+
+        for (size_t i = 0; i < counts[h]; ++i) {
+            for (size_t j = 0; j < ARRAY_ALG_STREE_B; ++j) {
+                size_t child = i * (ARRAY_ALG_STREE_B + 1) + j + 1;
+                size_t key = child * leaves_per_node * ARRAY_ALG_STREE_B;
+                *node = key < n ? sorted_first[key] : max;
+                ++node;
+            }
+        }
+        leaves_per_node *= ARRAY_ALG_STREE_B + 1;
+    }
+}
+
+ALGDEF size_t NS(stree_lower_bound)(
+        const T *stree,
+        size_t n,
+        const T *value
+        ) {
+    if (n == 0 || stree[0] < *value) return n;
+
+    size_t counts[ARRAY_ALG_STREE_MAX_LEVELS];
+    size_t h = NS(_stree_counts)(n, counts);
+
+    // Each level starts where the one above it ends.
+    const T *level = stree + ARRAY_ALG_STREE_B;
+    size_t index = 0;
+    while (--h != 0) {
+        const T *node = level + index * ARRAY_ALG_STREE_B;
+        index = index * (ARRAY_ALG_STREE_B + 1) + NS(_stree_node_rank)(node, *value);
+        level += counts[h] * ARRAY_ALG_STREE_B;
+    }
+    const T *leaf = level + index * ARRAY_ALG_STREE_B;
+    return index * ARRAY_ALG_STREE_B + NS(_stree_node_rank)(leaf, *value);
+}
+
+static int NS(_arithmetic_compare)(
+        const T *a,
+        const T *b,
+        void *ctx
+        ) {
+    (void)ctx;
+    return (*b < *a) - (*a < *b);
+}
+
+ALGDEF T *NS(interpolation_lower_bound)(
+        const T *first,
+        const T *last,
+        const T *value
+        ) {
+    if (first == last || !(*first < *value)) return (T*)first;
+    if (last[-1] < *value) return (T*)last;
+
+    // first[0] < value <= last[-1], so the keys are not all equal.
+    double low = (double)first[0];
+    double guess = ((double)*value - low) / ((double)last[-1] - low) * (double)(last - first - 1);
+    if (!(guess > 0.0)) guess = 0.0;
+
+    const T *hint = first + (size_t)guess;
+    if (hint >= last) hint = last - 1;
+    return NS(lower_bound_hint)(first, last, hint, value, NS(_arithmetic_compare), NULL);
+}
+
+#if defined(ARRAY_ALG_SCAN_BYTES)
+/// Whether the scans have a SIMD path for T.
+/// Integers of 1, 2, 4 or 8 bytes, floats and doubles.
+static int NS(_scannable)(void) {
+    const int is_integer = ((T)0.5 == 0);
+    return is_integer ? (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)
+        : (sizeof(T) == 4 || sizeof(T) == 8);
+}
+
+/// Compare the ARRAY_ALG_SCAN_BYTES bytes at p with x.
+/// Returns a mask with sizeof(T) bits set for each equal element.
+/// requires:
+/// - _scannable()
+static uint32_t NS(_scan_equal)(
+        const T *p,
+        T x
+        ) {
+    // These branches are constant for a given T.
+    const int is_integer = ((T)0.5 == 0);
+
+#if defined(__AVX2__)
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    __m256i match;
+    if (!is_integer && sizeof(T) == 4) {
+        float f;
+        memcpy(&f, &x, sizeof(f));
+        match = _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(v), _mm256_set1_ps(f), _CMP_EQ_OQ));
+    } else if (!is_integer) {
+        double d;
+        memcpy(&d, &x, sizeof(d));
+        match = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(v), _mm256_set1_pd(d), _CMP_EQ_OQ));
+    } else if (sizeof(T) == 1) {
+        int8_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(bits));
+    } else if (sizeof(T) == 2) {
+        int16_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm256_cmpeq_epi16(v, _mm256_set1_epi16(bits));
+    } else if (sizeof(T) == 4) {
+        int32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm256_cmpeq_epi32(v, _mm256_set1_epi32(bits));
+    } else {
+        int64_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm256_cmpeq_epi64(v, _mm256_set1_epi64x(bits));
+    }
+    return (uint32_t)_mm256_movemask_epi8(match);
+#else
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i match;
+    if (!is_integer && sizeof(T) == 4) {
+        float f;
+        memcpy(&f, &x, sizeof(f));
+        match = _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(v), _mm_set1_ps(f)));
+    } else if (!is_integer) {
+        double d;
+        memcpy(&d, &x, sizeof(d));
+        match = _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(v), _mm_set1_pd(d)));
+    } else if (sizeof(T) == 1) {
+        int8_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm_cmpeq_epi8(v, _mm_set1_epi8(bits));
+    } else if (sizeof(T) == 2) {
+        int16_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm_cmpeq_epi16(v, _mm_set1_epi16(bits));
+    } else if (sizeof(T) == 4) {
+        int32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm_cmpeq_epi32(v, _mm_set1_epi32(bits));
+    } else {
+        // SSE2 has no 64 bit compare. Both halves must be equal.
+        int64_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        match = _mm_cmpeq_epi32(v, _mm_set1_epi64x(bits));
+        match = _mm_and_si128(match, _mm_shuffle_epi32(match, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    return (uint32_t)_mm_movemask_epi8(match);
+#endif
+}
+
+/// Like _scan_equal, for the elements with low <= x < high.
+/// Integers compare x - low < high - low as unsigned numbers, which is one compare.
+/// requires:
+/// - _scannable()
+/// - low < high
+static uint32_t NS(_scan_in_range)(
+        const T *p,
+        T low,
+        T high
+        ) {
+    // These branches are constant for a given T.
+    const int is_integer = ((T)0.5 == 0);
+
+#if defined(__AVX2__)
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    __m256i match;
+    if (!is_integer && sizeof(T) == 4) {
+        float l;
+        float h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m256 f = _mm256_castsi256_ps(v);
+        match = _mm256_castps_si256(_mm256_and_ps(
+                    _mm256_cmp_ps(f, _mm256_set1_ps(l), _CMP_GE_OQ),
+                    _mm256_cmp_ps(f, _mm256_set1_ps(h), _CMP_LT_OQ)));
+    } else if (!is_integer) {
+        double l;
+        double h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m256d d = _mm256_castsi256_pd(v);
+        match = _mm256_castpd_si256(_mm256_and_pd(
+                    _mm256_cmp_pd(d, _mm256_set1_pd(l), _CMP_GE_OQ),
+                    _mm256_cmp_pd(d, _mm256_set1_pd(h), _CMP_LT_OQ)));
+    } else if (sizeof(T) == 1) {
+        uint8_t l;
+        uint8_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m256i bias = _mm256_set1_epi8(INT8_MIN);
+        __m256i offset = _mm256_xor_si256(_mm256_sub_epi8(v, _mm256_set1_epi8((int8_t)l)), bias);
+        match = _mm256_cmpgt_epi8(_mm256_set1_epi8((int8_t)(uint8_t)((h - l) ^ 0x80u)), offset);
+    } else if (sizeof(T) == 2) {
+        uint16_t l;
+        uint16_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m256i bias = _mm256_set1_epi16(INT16_MIN);
+        __m256i offset = _mm256_xor_si256(_mm256_sub_epi16(v, _mm256_set1_epi16((int16_t)l)), bias);
+        match = _mm256_cmpgt_epi16(_mm256_set1_epi16((int16_t)(uint16_t)((h - l) ^ 0x8000u)), offset);
+    } else if (sizeof(T) == 4) {
+        uint32_t l;
+        uint32_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m256i bias = _mm256_set1_epi32(INT32_MIN);
+        __m256i offset = _mm256_xor_si256(_mm256_sub_epi32(v, _mm256_set1_epi32((int32_t)l)), bias);
+        match = _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)((h - l) ^ 0x80000000u)), offset);
+    } else {
+        uint64_t l;
+        uint64_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+        __m256i offset = _mm256_xor_si256(_mm256_sub_epi64(v, _mm256_set1_epi64x((int64_t)l)), bias);
+        match = _mm256_cmpgt_epi64(_mm256_set1_epi64x((int64_t)((h - l) ^ 0x8000000000000000ULL)), offset);
+    }
+    return (uint32_t)_mm256_movemask_epi8(match);
+#else
+    if (is_integer && sizeof(T) == 8) {
+        // SSE2 has no 64 bit compare.
+        return (uint32_t)((low <= p[0] && p[0] < high) * 0xFF) | (uint32_t)((low <= p[1] && p[1] < high) * 0xFF00);
+    }
+
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i match;
+    if (!is_integer && sizeof(T) == 4) {
+        float l;
+        float h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m128 f = _mm_castsi128_ps(v);
+        match = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(f, _mm_set1_ps(l)), _mm_cmplt_ps(f, _mm_set1_ps(h))));
+    } else if (!is_integer) {
+        double l;
+        double h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m128d d = _mm_castsi128_pd(v);
+        match = _mm_castpd_si128(_mm_and_pd(_mm_cmpge_pd(d, _mm_set1_pd(l)), _mm_cmplt_pd(d, _mm_set1_pd(h))));
+    } else if (sizeof(T) == 1) {
+        uint8_t l;
+        uint8_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m128i bias = _mm_set1_epi8(INT8_MIN);
+        __m128i offset = _mm_xor_si128(_mm_sub_epi8(v, _mm_set1_epi8((int8_t)l)), bias);
+        match = _mm_cmpgt_epi8(_mm_set1_epi8((int8_t)(uint8_t)((h - l) ^ 0x80u)), offset);
+    } else if (sizeof(T) == 2) {
+        uint16_t l;
+        uint16_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m128i bias = _mm_set1_epi16(INT16_MIN);
+        __m128i offset = _mm_xor_si128(_mm_sub_epi16(v, _mm_set1_epi16((int16_t)l)), bias);
+        match = _mm_cmpgt_epi16(_mm_set1_epi16((int16_t)(uint16_t)((h - l) ^ 0x8000u)), offset);
+    } else {
+        uint32_t l;
+        uint32_t h;
+        memcpy(&l, &low, sizeof(l));
+        memcpy(&h, &high, sizeof(h));
+        __m128i bias = _mm_set1_epi32(INT32_MIN);
+        __m128i offset = _mm_xor_si128(_mm_sub_epi32(v, _mm_set1_epi32((int32_t)l)), bias);
+        match = _mm_cmpgt_epi32(_mm_set1_epi32((int32_t)((h - l) ^ 0x80000000u)), offset);
+    }
+    return (uint32_t)_mm_movemask_epi8(match);
+#endif
+}
+#endif
+
+ALGDEF T *NS(find_value)(
+        const T *first,
+        const T *last,
+        const T *value
+        ) {
+    const int is_integer = ((T)0.5 == 0);
+    if (is_integer && sizeof(T) == 1) {
+        const void *found = memchr(first, *(const unsigned char*)value, last - first);
+        return found ? (T*)found : (T*)last;
+    }
+
+#if defined(ARRAY_ALG_SCAN_BYTES)
+    if (NS(_scannable)()) {
+        const size_t lanes = ARRAY_ALG_SCAN_BYTES / sizeof(T);
+        T x = *value;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            uint32_t mask = NS(_scan_equal)(first, x);
+            if (mask) return (T*)first + array_alg_count_trailing_zeros(mask) / sizeof(T);
+        }
+    }
+#endif
+    while (first != last && !(*first == *value)) ++first;
+    return (T*)first;
+}
+
+ALGDEF size_t NS(count_value)(
+        const T *first,
+        const T *last,
+        const T *value
+        ) {
+    size_t count = 0;
+#if defined(ARRAY_ALG_SCAN_BYTES)
+    if (NS(_scannable)()) {
+        const size_t lanes = ARRAY_ALG_SCAN_BYTES / sizeof(T);
+        T x = *value;
+        size_t bits = 0;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            bits += array_alg_popcount(NS(_scan_equal)(first, x));
+        }
+        count = bits / sizeof(T);
+    }
+#endif
+    for (; first != last; ++first) count += *first == *value;
+    return count;
+}
+
+ALGDEF T *NS(find_first_of_values)(
+        const T *first,
+        const T *last,
+        const T *values_first,
+        const T *values_last
+        ) {
+    if (values_first == values_last) return (T*)last;
+
+#if defined(ARRAY_ALG_SCAN_BYTES)
+    if (NS(_scannable)()) {
+        const size_t lanes = ARRAY_ALG_SCAN_BYTES / sizeof(T);
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            uint32_t mask = 0;
+            for (const T *x = values_first; x != values_last; ++x) mask |= NS(_scan_equal)(first, *x);
+            if (mask) return (T*)first + array_alg_count_trailing_zeros(mask) / sizeof(T);
+        }
+    }
+#endif
+    for (; first != last; ++first) {
+        for (const T *x = values_first; x != values_last; ++x) {
+            if (*first == *x) return (T*)first;
+        }
+    }
+    return (T*)last;
+}
+
+ALGDEF T *NS(find_in_range)(
+        const T *first,
+        const T *last,
+        const T *low,
+        const T *high
+        ) {
+    if (!(*low < *high)) return (T*)last;
+
+#if defined(ARRAY_ALG_SCAN_BYTES)
+    if (NS(_scannable)()) {
+        const size_t lanes = ARRAY_ALG_SCAN_BYTES / sizeof(T);
+        T l = *low;
+        T h = *high;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            uint32_t mask = NS(_scan_in_range)(first, l, h);
+            if (mask) return (T*)first + array_alg_count_trailing_zeros(mask) / sizeof(T);
+        }
+    }
+#endif
+    while (first != last && !(*low <= *first && *first < *high)) ++first;
+    return (T*)first;
+}
+
+ALGDEF size_t NS(count_in_range)(
+        const T *first,
+        const T *last,
+        const T *low,
+        const T *high
+        ) {
+    if (!(*low < *high)) return 0;
+
+    size_t count = 0;
+#if defined(ARRAY_ALG_SCAN_BYTES)
+    if (NS(_scannable)()) {
+        const size_t lanes = ARRAY_ALG_SCAN_BYTES / sizeof(T);
+        T l = *low;
+        T h = *high;
+        size_t bits = 0;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            bits += array_alg_popcount(NS(_scan_in_range)(first, l, h));
+        }
+        count = bits / sizeof(T);
+    }
+#endif
+    for (; first != last; ++first) count += *low <= *first && *first < *high;
+    return count;
+}
+
+/// Independent accumulators of min_element_simd and friends.
+#define ARRAY_ALG_REDUCE_LANES 16
+
+/// Whether *x is a NaN. Always 0 for integers.
+/// Takes a pointer, since x != x on a value is a self-comparison warning for integers.
+static int NS(_is_nan)(
+        const T *x
+        ) {
+    // This branch is constant for a given T.
+    const int is_integer = ((T)0.5 == 0);
+    return !is_integer && *x != *x;
+}
+
+/// Whether the lanes can start from the first ARRAY_ALG_REDUCE_LANES elements.
+/// A NaN would never be replaced, so those ranges use the scalar versions.
+static int NS(_can_reduce)(
+        const T *first,
+        const T *last
+        ) {
+    if (last - first < 2 * ARRAY_ALG_REDUCE_LANES) return 0;
+    int has_nan = 0;
+    for (int j = 0; j < ARRAY_ALG_REDUCE_LANES; ++j) has_nan |= NS(_is_nan)(first + j);
+    return !has_nan;
+}
+
+/// Last element equal to x.
+/// requires:
+/// - x is in [first, last)
+static T *NS(_find_last_value)(
+        const T *first,
+        const T *last,
+        T x
+        ) {
+    while (last - first >= ARRAY_ALG_REDUCE_LANES) {
+        int any = 0;
+        for (int j = 1; j <= ARRAY_ALG_REDUCE_LANES; ++j) any |= last[-j] == x;
+        if (any) break;
+        last -= ARRAY_ALG_REDUCE_LANES;
+    }
+    do {
+        --last;
+    } while (!(*last == x));
+    return (T*)last;
+}
+
+ALGDEF T *NS(min_element_simd)(
+        const T *first,
+        const T *last
+        ) {
+    if (!NS(_can_reduce)(first, last)) return NS(min_element)(first, last, NS(_arithmetic_compare), NULL);
+
+    size_t n = last - first;
+    T lanes[ARRAY_ALG_REDUCE_LANES];
+    memcpy(lanes, first, sizeof(lanes));
+
+    size_t i = ARRAY_ALG_REDUCE_LANES;
+    for (; i + ARRAY_ALG_REDUCE_LANES <= n; i += ARRAY_ALG_REDUCE_LANES) {
+        for (int j = 0; j < ARRAY_ALG_REDUCE_LANES; ++j) {
+            lanes[j] = first[i + j] < lanes[j] ? first[i + j] : lanes[j];
+        }
+    }
+
+    T min = lanes[0];
+    for (int j = 1; j < ARRAY_ALG_REDUCE_LANES; ++j) min = lanes[j] < min ? lanes[j] : min;
+    for (; i < n; ++i) min = first[i] < min ? first[i] : min;
+    return NS(find_value)(first, last, &min);
+}
+
+ALGDEF T *NS(max_element_simd)(
+        const T *first,
+        const T *last
+        ) {
+    if (!NS(_can_reduce)(first, last)) return NS(max_element)(first, last, NS(_arithmetic_compare), NULL);
+
+    size_t n = last - first;
+    T lanes[ARRAY_ALG_REDUCE_LANES];
+    memcpy(lanes, first, sizeof(lanes));
+
+    size_t i = ARRAY_ALG_REDUCE_LANES;
+    for (; i + ARRAY_ALG_REDUCE_LANES <= n; i += ARRAY_ALG_REDUCE_LANES) {
+        for (int j = 0; j < ARRAY_ALG_REDUCE_LANES; ++j) {
+            lanes[j] = lanes[j] < first[i + j] ? first[i + j] : lanes[j];
+        }
+    }
+
+    T max = lanes[0];
+    for (int j = 1; j < ARRAY_ALG_REDUCE_LANES; ++j) max = max < lanes[j] ? lanes[j] : max;
+    for (; i < n; ++i) max = max < first[i] ? first[i] : max;
+    return NS(find_value)(first, last, &max);
+}
+
+ALGDEF void NS(minmax_element_simd)(
+        const T *first,
+        const T *last,
+        T** out_min,
+        T** out_max
+        ) {
+    if (!NS(_can_reduce)(first, last)) {
+        NS(minmax_element)(first, last, out_min, out_max, NS(_arithmetic_compare), NULL);
+        return;
+    }
+
+    size_t n = last - first;
+    T min_lanes[ARRAY_ALG_REDUCE_LANES];
+    T max_lanes[ARRAY_ALG_REDUCE_LANES];
+    memcpy(min_lanes, first, sizeof(min_lanes));
+    memcpy(max_lanes, first, sizeof(max_lanes));
+
+    // The pairwise comparisons of minmax_element skip some elements next to a NaN,
+    // so ranges with a NaN use it to get the same positions.
+    int unordered = 0;
+    size_t i = ARRAY_ALG_REDUCE_LANES;
+    for (; i + ARRAY_ALG_REDUCE_LANES <= n; i += ARRAY_ALG_REDUCE_LANES) {
+        for (int j = 0; j < ARRAY_ALG_REDUCE_LANES; ++j) {
+            T x = first[i + j];
+            min_lanes[j] = x < min_lanes[j] ? x : min_lanes[j];
+            max_lanes[j] = max_lanes[j] < x ? x : max_lanes[j];
+            unordered |= NS(_is_nan)(first + i + j);
+        }
+    }
+    for (size_t k = i; k < n; ++k) unordered |= NS(_is_nan)(first + k);
+    if (unordered) {
+        NS(minmax_element)(first, last, out_min, out_max, NS(_arithmetic_compare), NULL);
+        return;
+    }
+
+    T min = min_lanes[0];
+    T max = max_lanes[0];
+    for (int j = 1; j < ARRAY_ALG_REDUCE_LANES; ++j) {
+        min = min_lanes[j] < min ? min_lanes[j] : min;
+        max = max < max_lanes[j] ? max_lanes[j] : max;
+    }
+    for (; i < n; ++i) {
+        min = first[i] < min ? first[i] : min;
+        max = max < first[i] ? first[i] : max;
+    }
+    *out_min = NS(find_value)(first, last, &min);
+    *out_max = NS(_find_last_value)(first, last, max);
+}
+
+ALGDEF T *NS(unique_simd)(
+        T *first,
+        T *last
+        ) {
+    if (first == last) return first;
+
+    T *out = first + 1;
+    ++first;
+
+#if defined(ARRAY_ALG_COMPACT_LANES)
+    // These branches are constant for a given T.
+    const int is_integer = ((T)0.5 == 0);
+    if (ARRAY_ALG_COMPACT_LANES != 0) {
+        // Elements are only written at or before where they were read,
+        // so the one before each block is unchanged.
+        const size_t lanes = ARRAY_ALG_COMPACT_LANES;
+        for (; (size_t)(last - first) >= lanes; first += lanes) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)first);
+            __m256i previous = _mm256_loadu_si256((const __m256i*)(first - 1));
+            unsigned mask;
+            if (!is_integer && sizeof(T) == 4) {
+                mask = (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(
+                            _mm256_castsi256_ps(v), _mm256_castsi256_ps(previous), _CMP_NEQ_UQ));
+            } else if (!is_integer) {
+                mask = (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(
+                            _mm256_castsi256_pd(v), _mm256_castsi256_pd(previous), _CMP_NEQ_UQ));
+            } else if (sizeof(T) == 4) {
+                mask = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, previous))) & 0xFF;
+            } else {
+                mask = ~(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, previous))) & 0xF;
+            }
+            out += NS(_compact)(first, mask, out);
+        }
+    }
+#endif
+
+    for (; first != last; ++first) {
+        if (!(*first == out[-1])) {
+            *out = *first;
+            ++out;
+        }
+    }
+    return out;
+}
+#undef ARRAY_ALG_REDUCE_LANES
+
+ALGDEF size_t NS(learned_index_build)(
+        const T *sorted_first,
+        const T *sorted_last,
+        size_t max_error,
+        array_alg_pla_segment *out
+        ) {
+    double error = (double)max_error;
+    double slope_low = 0.0;
+    double slope_high = 0.0;
+    size_t points = 0;
+    size_t count = 0;
+
+    for (const T *it = sorted_first; it != sorted_last; ++it) {
+        // Model the lower_bound of each distinct key.
+        if (it != sorted_first && !(it[-1] < *it)) continue;
+
+        double key = (double)*it;
+        double position = (double)(it - sorted_first);
+
+        if (count != 0) {
+            array_alg_pla_segment *segment = out + count - 1;
+            double dx = key - segment->key;
+
+            // Distinct keys may be equal as doubles. Searches correct for this.
+            if (!(dx > 0.0)) continue;
+
+            // Every line through the segment start within the cone fits every point so far.
+            // Shrink it to fit this point too, or start a new segment.
+            double low = (position - error - segment->intercept) / dx;
+            double high = (position + error - segment->intercept) / dx;
+            if (low < 0.0) low = 0.0;
+
+            if (points == 1 || (low <= slope_high && high >= slope_low)) {
+                if (points == 1 || low > slope_low) slope_low = low;
+                if (points == 1 || high < slope_high) slope_high = high;
+                segment->slope = (slope_low + slope_high) / 2.0;
+                ++points;
+                continue;
+            }
+        }
+
+        out[count].key = key;
+        out[count].slope = 0.0;
+        out[count].intercept = position;
+        ++count;
+        points = 1;
+    }
+    return count;
+}
+
+ALGDEF T *NS(learned_index_lower_bound)(
+        const T *first,
+        const T *last,
+        const array_alg_pla_segment *segments,
+        size_t segment_count,
+        size_t max_error,
+        const T *value
+        ) {
+    size_t n = last - first;
+    if (segment_count == 0) return (T*)first;
+
+    double x = (double)*value;
+
+    // Last segment with key <= x, or the first segment.
+    const array_alg_pla_segment *segment = segments;
+    while (segment_count > 1) {
+        size_t half = segment_count >> 1;
+        segment_count -= half;
+        segment += (segment[half].key <= x) * half;
+    }
+
+    double guess = segment->intercept + segment->slope * (x - segment->key);
+    if (!(guess > 0.0)) guess = 0.0;
+    if (guess > (double)n) guess = (double)n;
+
+    size_t predicted = (size_t)guess;
+    size_t low = predicted > max_error ? predicted - max_error : 0;
+    size_t high = n - predicted > max_error + 1 ? predicted + max_error + 1 : n;
+
+    T *result = NS(_lower_bound_n)(first + low, high - low, value, NS(_arithmetic_compare), NULL);
+
+    if ((result == first + low && low != 0 && !(first[low - 1] < *value)) ||
+        (result == first + high && high != n && first[high] < *value)) {
+        return NS(lower_bound_hint)(first, last, result, value, NS(_arithmetic_compare), NULL);
+    }
+    return result;
+}
+
+/// Shared by set_intersection_simd and set_intersection_count.
+/// Writes the matches to out, unless it is NULL, and returns how many there are.
+static size_t NS(_set_intersection_simd)(
+        const T *a,
+        size_t n_a,
+        const T *b,
+        size_t n_b,
+        T *restrict out
+        ) {
+    // These branches are constant for a given T.
+    const int is_integer = ((T)0.5 == 0);
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t count = 0;
+
+#if defined(__AVX2__)
+    if (is_integer && sizeof(T) == 4) {
+        const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        while (i + 8 <= n_a && j + 8 <= n_b) {
+            __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+            __m256i match = _mm256_cmpeq_epi32(va, vb);
+            for (int r = 1; r < 8; ++r) {
+                vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+            }
+            unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(match));
+            int matches = array_alg_popcount(mask);
+
+            if (out) {
+#if defined(__BMI2__)
+                __m256i packed = _mm256_permutevar8x32_epi32(va, array_alg_left_pack_epi32(mask));
+                __m256i keep = _mm256_cmpgt_epi32(_mm256_set1_epi32(matches), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+                _mm256_maskstore_epi32((int*)(out + count), keep, packed);
+#else
+                T *p = out + count;
+                while (mask) {
+                    *p++ = a[i + array_alg_count_trailing_zeros(mask)];
+                    mask &= mask - 1;
+                }
+#endif
+            }
+            count += matches;
+
+            // Every element of the block with the smaller maximum has been compared
+            // with everything it could match.
+            T max_a = a[i + 7];
+            T max_b = b[j + 7];
+            i += (max_a <= max_b) * 8;
+            j += (max_b <= max_a) * 8;
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    if (is_integer && sizeof(T) == 4) {
+        while (i + 4 <= n_a && j + 4 <= n_b) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+            __m128i match = _mm_cmpeq_epi32(va, vb);
+            for (int r = 1; r < 4; ++r) {
+                vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+                match = _mm_or_si128(match, _mm_cmpeq_epi32(va, vb));
+            }
+            unsigned mask = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(match));
+
+            if (out) {
+                T *p = out + count;
+                for (unsigned m = mask; m; m &= m - 1) {
+                    *p++ = a[i + array_alg_count_trailing_zeros(m)];
+                }
+            }
+            count += array_alg_popcount(mask);
+
+            T max_a = a[i + 3];
+            T max_b = b[j + 3];
+            i += (max_a <= max_b) * 4;
+            j += (max_b <= max_a) * 4;
+        }
+    }
+#endif
+    while (i < n_a && j < n_b) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            if (out) out[count] = a[i];
+            ++count;
+            ++i;
+            ++j;
+        }
+    }
+    return count;
+}
+
+ALGDEF T *NS(set_intersection_simd)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out
+        ) {
+    return out + NS(_set_intersection_simd)(first_1, last_1 - first_1, first_2, last_2 - first_2, out);
+}
+
+ALGDEF size_t NS(set_intersection_count)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2
+        ) {
+    return NS(_set_intersection_simd)(first_1, last_1 - first_1, first_2, last_2 - first_2, NULL);
+}
+#endif
+
+#ifdef ARRAY_ALG_INTEGER
+/// Map a value to an unsigned key with the same order.
+static uint32_t NS(_packed_key)(
+        T x
+        ) {
+    const int is_signed = ((T)-1 < (T)1);
+    return is_signed ? (uint32_t)(int32_t)x ^ 0x80000000u : (uint32_t)x;
+}
+
+static T NS(_packed_value)(
+        uint32_t key
+        ) {
+    const int is_signed = ((T)-1 < (T)1);
+    return is_signed ? (T)(int32_t)(key ^ 0x80000000u) : (T)key;
+}
+
+/// Decode block b of the set to out.
+/// Returns the number of values in the block.
+static size_t NS(_packed_block_decode)(
+        const array_alg_packed_set *set,
+        size_t b,
+        T *out
+        ) {
+    const array_alg_packed_block *block = set->blocks + b;
+    size_t count = b + 1 < set->block_count ? ARRAY_ALG_PACKED_BLOCK : set->size - b * ARRAY_ALG_PACKED_BLOCK;
+    uint32_t key = block->first;
+    out[0] = NS(_packed_value)(key);
+
+    if (block->width == 0) {
+        for (size_t i = 1; i < count; ++i) out[i] = out[0];
+        return count;
+    }
+
+    const uint32_t *words = set->words + block->offset;
+    uint64_t mask = ((uint64_t)1 << block->width) - 1;
+    size_t bit = 0;
+    for (size_t i = 1; i < count; ++i) {
+        // A difference spans at most two words.
+        uint64_t window = words[bit >> 5] | ((uint64_t)words[(bit >> 5) + 1] << 32);
+        key += (uint32_t)((window >> (bit & 31)) & mask);
+        out[i] = NS(_packed_value)(key);
+        bit += block->width;
+    }
+    return count;
+}
 
-ALGDEF T *NS(find_if)(
+ALGDEF int NS(packed_set_build)(
+        array_alg_packed_set *set,
         const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+        const T *last
         ) {
+    size_t n = last - first;
+    size_t block_count = (n + ARRAY_ALG_PACKED_BLOCK - 1) / ARRAY_ALG_PACKED_BLOCK;
+    set->size = n;
+    set->block_count = block_count;
+    set->words = NULL;
+    set->blocks = malloc(block_count * sizeof(array_alg_packed_block));
+    if (block_count && !set->blocks) return 0;
+
+    size_t word_count = 0;
+    for (size_t b = 0; b < block_count; ++b) {
+        const T *block = first + b * ARRAY_ALG_PACKED_BLOCK;
+        size_t count = b + 1 < block_count ? ARRAY_ALG_PACKED_BLOCK : n - b * ARRAY_ALG_PACKED_BLOCK;
+
+        uint32_t previous = NS(_packed_key)(block[0]);
+        uint32_t bits = 0;
+        for (size_t i = 1; i < count; ++i) {
+            uint32_t key = NS(_packed_key)(block[i]);
+            bits |= key - previous;
+            previous = key;
+        }
 
-    while (first != last) {
-        if (predicate(first, predicate_ctx)) break; 
-        ++first;
+        set->blocks[b].first = NS(_packed_key)(block[0]);
+        set->blocks[b].last = previous;
+        set->blocks[b].width = array_alg_bit_width(bits);
+        set->blocks[b].offset = word_count;
+        word_count += ((count - 1) * set->blocks[b].width + 31) / 32;
     }
-    return (T*)first;
+
+    // One spare word, so decoding can always read two.
+    set->word_count = word_count;
+    set->words = calloc(word_count + 1, sizeof(uint32_t));
+    if (!set->words) {
+        NS(packed_set_free)(set);
+        return 0;
+    }
+
+    for (size_t b = 0; b < block_count; ++b) {
+        const T *block = first + b * ARRAY_ALG_PACKED_BLOCK;
+        size_t count = b + 1 < block_count ? ARRAY_ALG_PACKED_BLOCK : n - b * ARRAY_ALG_PACKED_BLOCK;
+        uint32_t *words = set->words + set->blocks[b].offset;
+        uint32_t width = set->blocks[b].width;
+        if (width == 0) continue;
+
+        size_t bit = 0;
+        for (size_t i = 1; i < count; ++i) {
+            uint64_t difference = NS(_packed_key)(block[i]) - NS(_packed_key)(block[i - 1]);
+            uint64_t shifted = difference << (bit & 31);
+            words[bit >> 5] |= (uint32_t)shifted;
+            words[(bit >> 5) + 1] |= (uint32_t)(shifted >> 32);
+            bit += width;
+        }
+    }
+    return 1;
 }
 
-ALGDEF T *NS(find_if_not)(
-        const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+ALGDEF void NS(packed_set_free)(
+        array_alg_packed_set *set
         ) {
+    free(set->words);
+    free(set->blocks);
+}
 
-    while (first != last) {
-        if (!predicate(first, predicate_ctx)) break; 
-        ++first;
+ALGDEF T *NS(packed_set_decode)(
+        const array_alg_packed_set *set,
+        T *out
+        ) {
+    for (size_t b = 0; b < set->block_count; ++b) {
+        out += NS(_packed_block_decode)(set, b, out);
     }
-    return (T*)first;
+    return out;
 }
 
-ALGDEF T *NS(find_if_unguarded)(
-        const T *first,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
+ALGDEF size_t NS(packed_set_lower_bound)(
+        const array_alg_packed_set *set,
+        const T *value
         ) {
+    uint32_t key = NS(_packed_key)(*value);
+
+    // First block which ends at or after value.
+    size_t low = 0;
+    size_t high = set->block_count;
+    while (low < high) {
+        size_t middle = low + ((high - low) >> 1);
+        if (set->blocks[middle].last < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == set->block_count) return set->size;
 
-    while (!predicate(first, predicate_ctx)) ++first;
-    return (T*)first;
+    T values[ARRAY_ALG_PACKED_BLOCK];
+    size_t count = NS(_packed_block_decode)(set, low, values);
+    size_t i = 0;
+    while (i < count && values[i] < *value) ++i;
+    return low * ARRAY_ALG_PACKED_BLOCK + i;
 }
 
-ALGDEF T* NS(find_if_not_unguarded)(
-        const T *first,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
+ALGDEF T *NS(packed_set_intersection)(
+        const array_alg_packed_set *a,
+        const array_alg_packed_set *b,
+        T *out
         ) {
+    T values_a[ARRAY_ALG_PACKED_BLOCK];
+    T values_b[ARRAY_ALG_PACKED_BLOCK];
+    size_t block_a = 0;
+    size_t block_b = 0;
+    size_t i = 0;
+    size_t j = 0;
+    size_t n_a = 0;
+    size_t n_b = 0;
 
-    while (predicate(first, predicate_ctx)) ++first;
-    return (T*)first;
+    while (1) {
+        if (i == n_a) {
+            if (j < n_b) {
+                uint32_t key = NS(_packed_key)(values_b[j]);
+                while (block_a < a->block_count && a->blocks[block_a].last < key) ++block_a;
+            }
+            if (block_a == a->block_count) break;
+            n_a = NS(_packed_block_decode)(a, block_a++, values_a);
+            i = 0;
+        }
+        if (j == n_b) {
+            uint32_t key = NS(_packed_key)(values_a[i]);
+            while (block_b < b->block_count && b->blocks[block_b].last < key) ++block_b;
+            if (block_b == b->block_count) break;
+            n_b = NS(_packed_block_decode)(b, block_b++, values_b);
+            j = 0;
+        }
+
+        while (i < n_a && j < n_b) {
+            if (values_a[i] < values_b[j]) {
+                ++i;
+            } else if (values_b[j] < values_a[i]) {
+                ++j;
+            } else {
+                *out = values_a[i];
+                ++out;
+                ++i;
+                ++j;
+            }
+        }
+    }
+    return out;
 }
 
-ALGDEF T *NS(find_last_if)(
-        const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+ALGDEF T *NS(packed_set_union)(
+        const array_alg_packed_set *a,
+        const array_alg_packed_set *b,
+        T *out
         ) {
+    T values_a[ARRAY_ALG_PACKED_BLOCK];
+    T values_b[ARRAY_ALG_PACKED_BLOCK];
+    size_t block_a = 0;
+    size_t block_b = 0;
+    size_t i = 0;
+    size_t j = 0;
+    size_t n_a = 0;
+    size_t n_b = 0;
 
-    const T *found = last;
+    while (1) {
+        if (i == n_a && block_a < a->block_count) {
+            n_a = NS(_packed_block_decode)(a, block_a++, values_a);
+            i = 0;
+        }
+        if (j == n_b && block_b < b->block_count) {
+            n_b = NS(_packed_block_decode)(b, block_b++, values_b);
+            j = 0;
+        }
 
-    while (first != last) {
-        if (predicate(first, predicate_ctx)) {
-            found = first;
+        if (i == n_a) {
+            out = NS(copy)(values_b + j, values_b + n_b, out);
+            while (block_b < b->block_count) out += NS(_packed_block_decode)(b, block_b++, out);
+            return out;
+        } else if (j == n_b) {
+            out = NS(copy)(values_a + i, values_a + n_a, out);
+            while (block_a < a->block_count) out += NS(_packed_block_decode)(a, block_a++, out);
+            return out;
+        }
+
+        while (i < n_a && j < n_b) {
+            if (values_a[i] < values_b[j]) {
+                *out = values_a[i];
+                ++i;
+            } else if (values_b[j] < values_a[i]) {
+                *out = values_b[j];
+                ++j;
+            } else {
+                *out = values_a[i];
+                ++i;
+                ++j;
+            }
+            ++out;
         }
-        ++first;
     }
-    return (T*)found;
 }
 
-ALGDEF int NS(any_of)(
-        const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+/// The smallest container for a cardinality and number of runs.
+static int NS(_roaring_type)(
+        size_t cardinality,
+        size_t runs
         ) {
-    return NS(find_if)(first, last, predicate, predicate_ctx) != last;
+    size_t array_bytes = cardinality <= ARRAY_ALG_ROARING_ARRAY_MAX ? cardinality * 2 : SIZE_MAX;
+    size_t run_bytes = runs * 4;
+    size_t bitmap_bytes = ARRAY_ALG_ROARING_BITMAP_WORDS * 8;
+    if (array_bytes <= run_bytes && array_bytes <= bitmap_bytes) return ARRAY_ALG_ROARING_ARRAY;
+    return run_bytes < bitmap_bytes ? ARRAY_ALG_ROARING_RUN : ARRAY_ALG_ROARING_BITMAP;
 }
 
-ALGDEF int NS(none_of)(
-        const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+/// Store sorted, distinct low bits in whichever container is smallest.
+/// Returns 0 if allocation failed.
+static int NS(_roaring_store_values)(
+        array_alg_roaring_container *c,
+        uint16_t key,
+        const uint16_t *values,
+        size_t n
         ) {
-    return NS(find_if)(first, last, predicate, predicate_ctx) == last;
+    size_t runs = n != 0;
+    for (size_t i = 1; i < n; ++i) runs += values[i] != values[i - 1] + 1;
+
+    c->key = key;
+    c->cardinality = (uint32_t)n;
+    c->type = (uint8_t)NS(_roaring_type)(n, runs);
+
+    if (c->type == ARRAY_ALG_ROARING_ARRAY) {
+        c->size = (uint32_t)n;
+        c->data = malloc(n * sizeof(uint16_t) + 1);
+        if (!c->data) return 0;
+        memcpy(c->data, values, n * sizeof(uint16_t));
+    } else if (c->type == ARRAY_ALG_ROARING_RUN) {
+        c->size = (uint32_t)runs;
+        uint16_t *pairs = malloc(runs * 2 * sizeof(uint16_t));
+        c->data = pairs;
+        if (!pairs) return 0;
+
+        size_t start = 0;
+        for (size_t i = 1; i <= n; ++i) {
+            if (i == n || values[i] != values[i - 1] + 1) {
+                pairs[0] = values[start];
+                pairs[1] = (uint16_t)(i - start - 1);
+                pairs += 2;
+                start = i;
+            }
+        }
+    } else {
+        c->size = 0;
+        uint64_t *words = calloc(ARRAY_ALG_ROARING_BITMAP_WORDS, sizeof(uint64_t));
+        c->data = words;
+        if (!words) return 0;
+        for (size_t i = 0; i < n; ++i) words[values[i] >> 6] |= (uint64_t)1 << (values[i] & 63);
+    }
+    return 1;
 }
 
-
-ALGDEF int NS(all_of)(
-        const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+/// Store a bitmap in whichever container is smallest.
+/// Returns 0 if allocation failed.
+static int NS(_roaring_store_bitmap)(
+        array_alg_roaring_container *c,
+        uint16_t key,
+        const uint64_t *words
         ) {
-    return NS(find_if_not)(first, last, predicate, predicate_ctx) == last;
+    size_t cardinality = 0;
+    size_t runs = 0;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < ARRAY_ALG_ROARING_BITMAP_WORDS; ++i) {
+        cardinality += array_alg_popcount(words[i]);
+        // A run starts at each set bit after a clear one.
+        runs += array_alg_popcount(words[i] & ~((words[i] << 1) | carry));
+        carry = words[i] >> 63;
+    }
+
+    int type = NS(_roaring_type)(cardinality, runs);
+    if (type == ARRAY_ALG_ROARING_ARRAY) {
+        uint16_t values[ARRAY_ALG_ROARING_ARRAY_MAX];
+        size_t n = 0;
+        for (size_t i = 0; i < ARRAY_ALG_ROARING_BITMAP_WORDS; ++i) {
+            for (uint64_t w = words[i]; w; w &= w - 1) {
+                values[n++] = (uint16_t)(i * 64 + array_alg_count_trailing_zeros(w));
+            }
+        }
+        return NS(_roaring_store_values)(c, key, values, n);
+    }
+
+    c->key = key;
+    c->type = (uint8_t)type;
+    c->cardinality = (uint32_t)cardinality;
+
+    if (type == ARRAY_ALG_ROARING_RUN) {
+        c->size = (uint32_t)runs;
+        uint16_t *pairs = malloc(runs * 2 * sizeof(uint16_t));
+        c->data = pairs;
+        if (!pairs) return 0;
+
+        // Alternate between finding the next set bit and the next clear bit.
+        size_t i = 0;
+        uint64_t w = words[0];
+        while (1) {
+            while (w == 0 && ++i < ARRAY_ALG_ROARING_BITMAP_WORDS) w = words[i];
+            if (i == ARRAY_ALG_ROARING_BITMAP_WORDS) break;
+            size_t start = i * 64 + array_alg_count_trailing_zeros(w);
+
+            w = ~words[i] & (~(uint64_t)0 << (start & 63));
+            while (w == 0 && ++i < ARRAY_ALG_ROARING_BITMAP_WORDS) w = ~words[i];
+            size_t end = i == ARRAY_ALG_ROARING_BITMAP_WORDS ? i * 64 : i * 64 + array_alg_count_trailing_zeros(w);
+
+            pairs[0] = (uint16_t)start;
+            pairs[1] = (uint16_t)(end - start - 1);
+            pairs += 2;
+            if (i == ARRAY_ALG_ROARING_BITMAP_WORDS) break;
+            w = words[i] & (~(uint64_t)0 << (end & 63));
+        }
+        return 1;
+    }
+
+    c->size = 0;
+    c->data = malloc(ARRAY_ALG_ROARING_BITMAP_WORDS * sizeof(uint64_t));
+    if (!c->data) return 0;
+    memcpy(c->data, words, ARRAY_ALG_ROARING_BITMAP_WORDS * sizeof(uint64_t));
+    return 1;
 }
 
-ALGDEF size_t NS(count_if)(
-        const T* first,
-        const T* last,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+static void NS(_roaring_to_bitmap)(
+        const array_alg_roaring_container *c,
+        uint64_t *words
         ) {
+    if (c->type == ARRAY_ALG_ROARING_BITMAP) {
+        memcpy(words, c->data, ARRAY_ALG_ROARING_BITMAP_WORDS * sizeof(uint64_t));
+        return;
+    }
 
-    size_t count = 0;
-    while (first != last) {
-        if (predicate(first, predicate_ctx)) ++count;
-        ++first;
+    memset(words, 0, ARRAY_ALG_ROARING_BITMAP_WORDS * sizeof(uint64_t));
+    const uint16_t *data = c->data;
+    if (c->type == ARRAY_ALG_ROARING_ARRAY) {
+        for (size_t i = 0; i < c->size; ++i) words[data[i] >> 6] |= (uint64_t)1 << (data[i] & 63);
+    } else {
+        for (size_t i = 0; i < c->size; ++i) {
+            size_t x = data[2 * i];
+            size_t end = x + data[2 * i + 1] + 1;
+            for (; x < end && (x & 63); ++x) words[x >> 6] |= (uint64_t)1 << (x & 63);
+            for (; x + 64 <= end; x += 64) words[x >> 6] = ~(uint64_t)0;
+            for (; x < end; ++x) words[x >> 6] |= (uint64_t)1 << (x & 63);
+        }
     }
-    return count;
 }
 
-ALGDEF void NS(mismatch)(
-        const T **first_1,
-        const T *last_1,
-        const T **first_2,
-        int (*compare)(const T*, const T*, void*),
-        void* compare_ctx
+static int NS(_roaring_contains)(
+        const array_alg_roaring_container *c,
+        uint16_t x
         ) {
-
-    const T* f1 = *first_1;
-    const T* f2 = *first_2;
-    while (f1 != last_1) {
-        if (compare(f1, f2, compare_ctx) != 0) {
-            break;
-        } 
-        ++f1;
-        ++f2;
+    const uint16_t *data = c->data;
+    if (c->type == ARRAY_ALG_ROARING_BITMAP) {
+        return (((const uint64_t*)c->data)[x >> 6] >> (x & 63)) & 1;
+    } else if (c->type == ARRAY_ALG_ROARING_ARRAY) {
+        size_t low = 0;
+        size_t high = c->size;
+        while (low < high) {
+            size_t middle = low + ((high - low) >> 1);
+            if (data[middle] < x) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low < c->size && data[low] == x;
+    } else {
+        // Last run starting at or before x.
+        size_t low = 0;
+        size_t high = c->size;
+        while (low < high) {
+            size_t middle = low + ((high - low) >> 1);
+            if (data[2 * middle] <= x) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low != 0 && x - data[2 * (low - 1)] <= data[2 * (low - 1) + 1];
     }
-    *first_1 = f1;
-    *first_2 = f2;
 }
 
-ALGDEF T *NS(adjacent_find)(
+static int NS(_roaring_copy)(
+        array_alg_roaring_container *out,
+        const array_alg_roaring_container *c
+        ) {
+    size_t bytes = c->type == ARRAY_ALG_ROARING_BITMAP ? ARRAY_ALG_ROARING_BITMAP_WORDS * sizeof(uint64_t)
+        : c->type == ARRAY_ALG_ROARING_ARRAY ? c->size * sizeof(uint16_t)
+        : c->size * 2 * sizeof(uint16_t);
+    *out = *c;
+    out->data = malloc(bytes + 1);
+    if (!out->data) return 0;
+    memcpy(out->data, c->data, bytes);
+    return 1;
+}
+
+ALGDEF int NS(roaring_build)(
+        array_alg_roaring *set,
         const T *first,
-        const T *last,
-        int (*compare)(const T*, const T*, void*),
-        void* compare_ctx
+        const T *last
         ) {
+    size_t n = last - first;
+    size_t capacity = n < 65536 ? n : 65536;
+    set->count = 0;
+    set->containers = malloc(capacity * sizeof(array_alg_roaring_container) + 1);
+    uint16_t *values = malloc(65536 * sizeof(uint16_t));
+    if (!set->containers || !values) {
+        free(values);
+        NS(roaring_free)(set);
+        return 0;
+    }
 
-    if (first != last)
-    {
-        const T* prev = first;
-        const T* next = prev;
-        ++next;
+    while (first != last) {
+        uint32_t key = NS(_packed_key)(*first);
+        uint16_t high = (uint16_t)(key >> 16);
+        size_t count = 0;
 
-        while (next != last) {
-            if (compare(prev, next, compare_ctx) == 0) {
-                return (T*)prev;
-            }
-            prev = next;
-            ++next;
+        while (first != last && (key = NS(_packed_key)(*first)) >> 16 == high) {
+            if (count == 0 || values[count - 1] != (uint16_t)key) values[count++] = (uint16_t)key;
+            ++first;
         }
+
+        if (!NS(_roaring_store_values)(set->containers + set->count, high, values, count)) {
+            free(values);
+            NS(roaring_free)(set);
+            return 0;
+        }
+        ++set->count;
     }
+    free(values);
+    return 1;
+}
 
-    return (T*)last;
+ALGDEF void NS(roaring_free)(
+        array_alg_roaring *set
+        ) {
+    if (!set->containers) return;
+    for (size_t i = 0; i < set->count; ++i) free(set->containers[i].data);
+    free(set->containers);
 }
 
-ALGDEF T *NS(copy)(
-        const T *first,
-        const T *last,
-        T *out
+ALGDEF size_t NS(roaring_cardinality)(
+        const array_alg_roaring *set
         ) {
-    size_t n = (last - first);
-    memcpy(out, first, n * sizeof(T));
-    return out + n; 
+    size_t cardinality = 0;
+    for (size_t i = 0; i < set->count; ++i) cardinality += set->containers[i].cardinality;
+    return cardinality;
 }
 
-ALGDEF T *NS(copy_n)(
-        const T *first,
-        size_t n,
+ALGDEF T *NS(roaring_decode)(
+        const array_alg_roaring *set,
         T *out
         ) {
-    memcpy(out, first, n * sizeof(T));
-    return out + n;
+    for (size_t i = 0; i < set->count; ++i) {
+        const array_alg_roaring_container *c = set->containers + i;
+        uint32_t high = (uint32_t)c->key << 16;
+        const uint16_t *data = c->data;
+
+        if (c->type == ARRAY_ALG_ROARING_ARRAY) {
+            for (size_t j = 0; j < c->size; ++j) *out++ = NS(_packed_value)(high | data[j]);
+        } else if (c->type == ARRAY_ALG_ROARING_RUN) {
+            for (size_t j = 0; j < c->size; ++j) {
+                uint32_t x = data[2 * j];
+                uint32_t end = x + data[2 * j + 1];
+                for (; x <= end; ++x) *out++ = NS(_packed_value)(high | x);
+            }
+        } else {
+            const uint64_t *words = c->data;
+            for (size_t j = 0; j < ARRAY_ALG_ROARING_BITMAP_WORDS; ++j) {
+                for (uint64_t w = words[j]; w; w &= w - 1) {
+                    *out++ = NS(_packed_value)(high | (uint32_t)(j * 64 + array_alg_count_trailing_zeros(w)));
+                }
+            }
+        }
+    }
+    return out;
 }
 
+#ifndef ARRAY_ALG_ROARING_OPS_
+#define ARRAY_ALG_ROARING_OPS_
+enum {
+    ARRAY_ALG_ROARING_AND,
+    ARRAY_ALG_ROARING_OR,
+    ARRAY_ALG_ROARING_AND_NOT
+};
+#endif
 
-ALGDEF T *NS(copy_if)(
-        const T *first,
-        const T *last,
-        T *out,
-        int (*predicate)(const T*,  void*),
-        void* predicate_ctx
+/// Combine two containers with the same key.
+/// An empty result is not stored, and out->cardinality is 0.
+/// Returns 0 if allocation failed.
+static int NS(_roaring_combine)(
+        const array_alg_roaring_container *a,
+        const array_alg_roaring_container *b,
+        int op,
+        array_alg_roaring_container *out
         ) {
+    uint16_t values[ARRAY_ALG_ROARING_ARRAY_MAX];
+    size_t n = 0;
+    out->cardinality = 0;
+
+    if (op != ARRAY_ALG_ROARING_OR && a->type == ARRAY_ALG_ROARING_ARRAY && b->type == ARRAY_ALG_ROARING_ARRAY) {
+        const uint16_t *x = a->data;
+        const uint16_t *y = b->data;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a->size && j < b->size) {
+            values[n] = x[i];
+            n += op == ARRAY_ALG_ROARING_AND ? x[i] == y[j] : x[i] < y[j];
+            uint16_t next = x[i];
+            i += next <= y[j];
+            j += y[j] <= next;
+        }
+        if (op == ARRAY_ALG_ROARING_AND_NOT) {
+            while (i < a->size) values[n++] = x[i++];
+        }
+        return n == 0 || NS(_roaring_store_values)(out, a->key, values, n);
+    }
 
-    while (first != last) {
-        if (predicate(first, predicate_ctx)) {
-            *out = *first;
-            ++out;
+    // Keep small results as arrays, checking the elements of the array against the other container.
+    if (op == ARRAY_ALG_ROARING_AND && (a->type == ARRAY_ALG_ROARING_ARRAY || b->type == ARRAY_ALG_ROARING_ARRAY)) {
+        if (a->type != ARRAY_ALG_ROARING_ARRAY) {
+            const array_alg_roaring_container *t = a;
+            a = b;
+            b = t;
         }
-        ++first;
+        const uint16_t *data = a->data;
+        for (size_t i = 0; i < a->size; ++i) {
+            values[n] = data[i];
+            n += NS(_roaring_contains)(b, data[i]);
+        }
+        return n == 0 || NS(_roaring_store_values)(out, a->key, values, n);
+    }
+    if (op == ARRAY_ALG_ROARING_AND_NOT && a->type == ARRAY_ALG_ROARING_ARRAY) {
+        const uint16_t *data = a->data;
+        for (size_t i = 0; i < a->size; ++i) {
+            values[n] = data[i];
+            n += !NS(_roaring_contains)(b, data[i]);
+        }
+        return n == 0 || NS(_roaring_store_values)(out, a->key, values, n);
+    }
+    if (op == ARRAY_ALG_ROARING_OR && a->type == ARRAY_ALG_ROARING_ARRAY && b->type == ARRAY_ALG_ROARING_ARRAY &&
+            a->size + b->size <= ARRAY_ALG_ROARING_ARRAY_MAX) {
+        const uint16_t *x = a->data;
+        const uint16_t *y = b->data;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a->size && j < b->size) {
+            uint16_t next = x[i] < y[j] ? x[i] : y[j];
+            i += x[i] == next;
+            j += y[j] == next;
+            values[n++] = next;
+        }
+        while (i < a->size) values[n++] = x[i++];
+        while (j < b->size) values[n++] = y[j++];
+        return NS(_roaring_store_values)(out, a->key, values, n);
     }
-    return out;
-}
 
-ALGDEF T *NS(copy_backward)(
-        const T *first,
-        const T *last,
-        T *last_out
-        ) {
+    uint64_t words[ARRAY_ALG_ROARING_BITMAP_WORDS];
+    uint64_t other[ARRAY_ALG_ROARING_BITMAP_WORDS];
+    NS(_roaring_to_bitmap)(a, words);
+    NS(_roaring_to_bitmap)(b, other);
 
-    while (first != last) {
-        --last;
-        --last_out;
-        *last_out = *last;
+    uint64_t any = 0;
+    if (op == ARRAY_ALG_ROARING_AND) {
+        for (size_t i = 0; i < ARRAY_ALG_ROARING_BITMAP_WORDS; ++i) any |= words[i] &= other[i];
+    } else if (op == ARRAY_ALG_ROARING_OR) {
+        for (size_t i = 0; i < ARRAY_ALG_ROARING_BITMAP_WORDS; ++i) any |= words[i] |= other[i];
+    } else {
+        for (size_t i = 0; i < ARRAY_ALG_ROARING_BITMAP_WORDS; ++i) any |= words[i] &= ~other[i];
     }
-    return last_out;
+    return !any || NS(_roaring_store_bitmap)(out, a->key, words);
 }
 
-ALGDEF int NS(lexicographical_compare)(
-        const T *first_1,
-        const T *last_1,
-        const T *first_2,
-        const T *last_2,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+static int NS(_roaring_op)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        int op,
+        array_alg_roaring *out
         ) {
-    while (1) {
-        if (first_1 == last_1 && first_2 == last_2) {
+    out->count = 0;
+    out->containers = malloc((a->count + b->count) * sizeof(array_alg_roaring_container) + 1);
+    if (!out->containers) return 0;
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count || j < b->count) {
+        array_alg_roaring_container *c = out->containers + out->count;
+        int ok = 1;
+
+        if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            if (op != ARRAY_ALG_ROARING_AND) {
+                ok = NS(_roaring_copy)(c, a->containers + i);
+                ++out->count;
+            }
+            ++i;
+        } else if (i == a->count || b->containers[j].key < a->containers[i].key) {
+            if (op == ARRAY_ALG_ROARING_OR) {
+                ok = NS(_roaring_copy)(c, b->containers + j);
+                ++out->count;
+            }
+            ++j;
+        } else {
+            ok = NS(_roaring_combine)(a->containers + i, b->containers + j, op, c);
+            out->count += c->cardinality != 0;
+            ++i;
+            ++j;
+        }
+
+        if (!ok) {
+            // A failed container has a null data pointer.
+            NS(roaring_free)(out);
             return 0;
-        } else if (first_1 == last_1) {
-            return -1;
-        } else if (first_2 == last_2) {
-            return 1;
         }
+    }
+    return 1;
+}
 
-        int result = cmp(first_1, first_2, cmp_ctx);
-        if (result != 0) return result;
+ALGDEF int NS(roaring_intersection)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        array_alg_roaring *out
+        ) {
+    return NS(_roaring_op)(a, b, ARRAY_ALG_ROARING_AND, out);
+}
 
-        ++first_1;
-        ++first_2;
-    }
+ALGDEF int NS(roaring_union)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        array_alg_roaring *out
+        ) {
+    return NS(_roaring_op)(a, b, ARRAY_ALG_ROARING_OR, out);
+}
 
+ALGDEF int NS(roaring_difference)(
+        const array_alg_roaring *a,
+        const array_alg_roaring *b,
+        array_alg_roaring *out
+        ) {
+    return NS(_roaring_op)(a, b, ARRAY_ALG_ROARING_AND_NOT, out);
 }
+#endif
 
-ALGDEF int NS(equal)(
-        const T *first_1,
-        const T *last_1,
-        const T *first_2,
+ALGDEF int NS(next_permutation)(
+        T *first,
+        T *last,
         int (*cmp)(const T*, const T*, void*),
         void* cmp_ctx
         ) {
-    while (first_1 != last_1) {
-        int result = cmp(first_1, first_2, cmp_ctx);
-        if (result != 0) return 0;
 
-        ++first_1;
-        ++first_2;
+    if (first == last) return 0;
+    T *l = last;
+    --l;
+
+
+    T *next = l - 1;
+    while (l != first && cmp(next, l, cmp_ctx) >= 0)
+    {
+        l = next;
+        --next;
     }
-    return 1;
-}
 
-ALGDEF void NS(swap)(T *a, T *b) {
-    T temp = *a;
-    *a = *b;
-    *b = temp;
+    if (l != first)
+    {
+        T *f = last - 1;
+        while (f != next && cmp(next, f, cmp_ctx) >= 0)
+        {
+            --f;
+        }
+
+        NS(swap)(next, f);
+        NS(reverse)(l, last);
+        return 1;
+    }
+    else
+    {
+        NS(reverse(first, last));
+        return 0;
+    }
 }
 
-ALGDEF T *NS(swap_ranges)(
-        T *first_1,
-        T *last_1,
-        T *first_2
-        ) {
 
-    while (first_1 != last_1) {
-        NS(swap)(first_1, first_2);
-        ++first_1;
-        ++first_2;
+ALGDEF void NS(random_shuffle_n)(
+        T *first,
+        size_t n
+        ) {
+    while (n > 1)
+    {
+        size_t j = ARRAY_ALG_RANDOM(n);
+        --n;
+        NS(swap)(first + n, first + j);
     }
-    return first_2;
 }
 
-ALGDEF void NS(reverse)(
+
+ALGDEF void NS(random_shuffle)(
         T *first,
         T *last
         ) {
-    if (first == last) return;
+    NS(random_shuffle_n)(first, last - first);
+}
 
-    --last;
-    while (first < last) {
-        NS(swap)(first, last);
+ALGDEF T* NS(sample)(
+        const T *first,
+        const T *last,
+        T* out,
+        size_t count
+        ) {
+    for (size_t i = 0; i < count; ++i) {
+        if (first == last) {
+            return out + i;
+        }
+        out[i] = *first;
         ++first;
-        --last;
     }
-}
 
-ALGDEF T *NS(reverse_copy)(
-        const T *restrict first,
-        const T *restrict last,
-        T *out
-        ) {
-    if (first == last) return out;
+    size_t range = count + 1;
+    while (first != last) {
+        size_t j = ARRAY_ALG_RANDOM(range);
 
-    do {
-        --last;
-        *out = *last;
-        ++out;
-    } while (first != last);
-    return out;
+        if (j < count) {
+            out[j] = *first;
+        }
+        ++first;
+        ++range;
+    }
+    return out + count;
 }
 
-ALGDEF T *NS(merge)(
-        const T *first_1,
-        const T *last_1,
-        const T *first_2,
-        const T *last_2,
-        T *restrict out,
-        int (*compare)(const T*, const T*, void*),
-        void *compare_ctx
+ALGDEF T *NS(is_heap_until)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void *),
+        void* compare_ctx
         ) {
+    if (first == last) return last;
 
-    if (first_2 == last_2) {
-        return NS(copy)(first_1, last_1, out);
-    } else if (first_1 == last_1) {
-        return NS(copy)(first_2, last_2, out);
-    }
+    T *half = first;
+    ++first;
 
     while (1) {
-        if (compare(first_1, first_2, compare_ctx) >= 0) {
-            *out = *first_2;
-            ++out;
-            ++first_2;
-
-            if (first_2 == last_2) {
-                return NS(copy)(first_1, last_1, out);
-            }
-        } else {
-            *out = *first_1;
-            ++out;
-            ++first_1;
-
-            if (first_1 == last_1) {
-                return NS(copy)(first_2, last_2, out);
-            }
+        if (first == last || compare(half, first, compare_ctx) < 0) {
+            return first;
+        }
+        ++first;
+        if (first == last || compare(half, first, compare_ctx) < 0) {
+            return first;
         }
+        ++first;
+        ++half;
     }
+    return first;
 }
 
-ALGDEF void NS(merge_with_buffer)(
+
+ALGDEF int NS(is_heap)(
         T *first,
-        T *middle,
         T *last,
-        T *buffer,
-        int (*compare)(const T*, const T*, void*),
-        void *compare_ctx
-        )  {
-    T* buffer_last = NS(copy)(first, middle, buffer);
-    NS(merge)(buffer, buffer_last, middle, last, first, compare, compare_ctx);
+        int (*compare)(const T*, const T*, void *),
+        void* compare_ctx
+        ) {
+    return NS(is_heap_until)(first, last, compare, compare_ctx) == last;
 }
 
-ALGDEF T *NS(remove_if)(
+ALGDEF void NS(push_heap_n)(
         T *first,
-        T *last,
-        int (*pred)(const T*, void*),
-        void *pred_ctx
+        size_t count,
+        int (*compare)(const T*, const T*, void *),
+        void* compare_ctx
         ) {
-    if (first == last) return first;
+    if (count <= 1) return;
 
-    T *out = first;
+    size_t index = count - 1;
 
-    while (first != last) {
-        if (!pred(first, pred_ctx)) {
-            *out = *first;
-            ++out;
+    while (index != 0) {
+        size_t parent_index = (index - 1) >> 1;
+
+        T* elem = first + index;
+        T* parent = first + parent_index;
+
+        if (compare(elem, parent, compare_ctx) <= 0) {
+            break;
         }
-        ++first;
+        NS(swap)(elem, parent);
+        index = parent_index;
     }
-    return out;
 }
 
-ALGDEF T *NS(remove_if_not)(
+ALGDEF void NS(push_heap)(
         T *first,
         T *last,
-        int (*pred)(const T*, void*),
-        void *pred_ctx
+        int (*compare)(const T*, const T*, void *),
+        void *compare_ctx
         ) {
-    if (first == last) return first;
-
-    T *out = first;
-
-    while (first != last) {
-        if (pred(first, pred_ctx)) {
-            *out = *first;
-            ++out;
-        }
-        ++first;
-    }
-    return out;
+    NS(push_heap_n)(first, last - first, compare, compare_ctx);
 }
 
-
-ALGDEF T *NS(replace_if)(
+ALGDEF void NS(pop_heap_n)(
         T *first,
-        T *last,
-        const T *replacement,
-        int (*pred)(const T*, void*),
-        void *pred_ctx
+        size_t count,
+        int (*compare)(const T*, const T*, void *),
+        void *compare_ctx
         ) {
-    while (first != last) {
-        if (pred(first, pred_ctx)) {
-            *first = *replacement;
+    if (count <= 1) return;
+
+    --count;
+    T *end = first + count;
+    NS(swap)(first, end);
+
+    size_t index = 0;
+    while (1) {
+        T *elem = first + index;
+        index = index * 2 + 1;
+        if (index >= count) break;
+
+        T *child = first + index;
+        if (compare(child, elem, compare_ctx) > 0) {
+            // left child is larger
+
+            // if right is larger use that 
+            if (index + 1 < count
+                    && compare(child + 1, child, compare_ctx) > 0) {
+                ++index;
+                ++child;
+            }
+        } else {
+            ++index;
+            ++child;
+            if (index >= count || compare(child, elem, compare_ctx) <= 0) {
+                break;
+            }
+            // right child is larger
         }
-        ++first;
+        NS(swap)(elem, child);
     }
-    return first;
 }
 
-ALGDEF T *NS(unique)(
+ALGDEF void NS(pop_heap)(
         T *first,
         T *last,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+        int (*compare)(const T*, const T*, void *),
+        void *compare_ctx
         ) {
-    if (first == last) return first;
-
-    T *out = first;
-    ++first;
+    return NS(pop_heap_n)(first, last - first, compare, compare_ctx);
+}
 
-    while (first != last) {
-        if (cmp(out, first, cmp_ctx) != 0) {
-            ++out;
-            *out = *first;
-        }
-        ++first;
+ALGDEF void NS(make_heap_n)(
+        T *first,
+        size_t count,
+        int (*compare)(const T*, const T*, void *),
+        void* compare_ctx
+        ) {
+    for (size_t n = 2; n <= count; ++n) {
+        NS(push_heap_n)(first, n, compare, compare_ctx);
     }
-    ++out;
-    return out;
 }
 
-ALGDEF T *NS(unique_copy)(
-        T *restrict first,
+ALGDEF void NS(make_heap)(
+        T *first,
         T *last,
-        T *restrict out,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (first == last) return out;
-
-    *out = *first;
-
-    while (first != last) {
-        if (cmp(out, first, cmp_ctx) != 0) {
-            ++out;
-            *out = *first;
-        }
-        ++first;
-    }
-    ++out;
-    return out;
+    NS(make_heap_n)(first, last - first, compare, compare_ctx);
 }
 
-ALGDEF T *NS(fill)(
+ALGDEF void NS(sort_heap)(
         T *first,
         T *last,
-        const T *x
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    while (first != last) {
-        *first = *x;
-        ++first;
+    while (last != first) {
+        NS(pop_heap)(first, last, compare, compare_ctx);
+        --last;
     }
-    return first;
 }
 
-ALGDEF T *NS(fill_n)(
-        T *first,
-        size_t count,
-        const T *x
-        ) {
-    for (size_t i = 0; i < count; ++i) {
-        first[i] = *x;
+/// Levels alternate between min and max, starting with a min level at the root.
+static int NS(_minmax_heap_is_max_level)(size_t index) {
+    int is_max = 0;
+    ++index;
+    while (index > 1) {
+        index >>= 1;
+        is_max = !is_max;
     }
-    return first + count;
+    return is_max;
 }
 
-ALGDEF int NS(set_includes)(
-        const T *first_sub,
-        const T *last_sub,
-        const T *first_super,
-        const T *last_super,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+/// Should a be above b on a level of the given kind?
+static int NS(_minmax_heap_before)(
+        const T *a,
+        const T *b,
+        int is_max,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
+    return is_max ? compare(a, b, compare_ctx) > 0 : compare(a, b, compare_ctx) < 0;
+}
 
-    if (first_sub == last_sub) return 1;
+/// Move the element at index up through its grandparents, which are all on the same kind of level.
+static void NS(_minmax_heap_bubble_up)(
+        T *first,
+        size_t index,
+        int is_max,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    while (index > 2) {
+        size_t grandparent = (((index - 1) >> 1) - 1) >> 1;
+        if (!NS(_minmax_heap_before)(first + index, first + grandparent, is_max, compare, compare_ctx)) break;
 
-    while (first_super != last_super) {
-        int result = cmp(first_sub, first_super, cmp_ctx);
-        if (result < 0) {
-            return 0;
-        } else if (result == 0) {
-            ++first_sub;
-            if (first_sub == last_sub) return 1;
-        }
-        ++first_super;
+        NS(swap)(first + index, first + grandparent);
+        index = grandparent;
     }
-    return 0;
 }
 
-
-ALGDEF T *NS(set_union)(
-        const T *first_1,
-        const T *last_1,
-        const T *first_2,
-        const T *last_2,
-        T *restrict out,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+static void NS(_minmax_heap_trickle_down)(
+        T *first,
+        size_t count,
+        size_t index,
+        int is_max,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
     while (1) {
-        if (first_1 == last_1) {
-            return NS(copy)(first_2, last_2, out);
-        } else if (first_2 == last_2) {
-            return NS(copy)(first_1, last_1, out);
-        }
-
-        int result = cmp(first_1, first_2, cmp_ctx);
-        if (result == 0) {
-            *out = *first_1;
-            ++first_1;
-            ++first_2;
-        } else if (result >= 0) {
-            *out = *first_2;
-            ++first_2;
-        } else {
-            *out = *first_1;
-            ++first_1;
+        size_t child = index * 2 + 1;
+        if (child >= count) return;
+
+        // Find the best of the children and grandchildren.
+        size_t best = child;
+        if (child + 1 < count
+                && NS(_minmax_heap_before)(first + child + 1, first + best, is_max, compare, compare_ctx)) {
+            best = child + 1;
         }
-        ++out;
-    }
-}
 
-ALGDEF T *NS(set_difference)(
-        const T *first_1,
-        const T *last_1,
-        const T *first_2,
-        const T *last_2,
-        T *out,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
-        ) {
-    if (first_1 == last_1 || first_2 == last_2) return out;
+        size_t grandchild = child * 2 + 1;
+        size_t grandchild_last = grandchild + 4;
+        if (grandchild_last > count) grandchild_last = count;
 
-    while (1) {
-        int result = cmp(first_1, first_2, cmp_ctx);
-        if (result == 0) {
-            ++first_1;
-            ++first_2;
-            if (first_1 == last_1) return out;
-            if (first_2 == last_2) {
-                return NS(copy)(first_1, last_1, out);
-            }
-        } else if (result < 0) {
-            if (out != first_1) *out = *first_1;
-            ++first_1;
-            ++out;
-            if (first_1 == last_1) return out;
-        } else if (result > 0) {
-            ++first_2;
-            if (first_2 == last_2) {
-                return NS(copy)(first_1, last_1, out);
+        for (size_t i = grandchild; i < grandchild_last; ++i) {
+            if (NS(_minmax_heap_before)(first + i, first + best, is_max, compare, compare_ctx)) {
+                best = i;
             }
         }
-    }
-}
 
-ALGDEF T *NS(set_intersection)(
-        const T *first_1,
-        const T *last_1,
-        const T *first_2,
-        const T *last_2,
-        T *out,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
-        ) {
-    if (first_1 == last_1 || first_2 == last_2) return out;
+        if (!NS(_minmax_heap_before)(first + best, first + index, is_max, compare, compare_ctx)) return;
+        NS(swap)(first + best, first + index);
 
-    while (1) {
-        int result = cmp(first_1, first_2, cmp_ctx);
-        if (result == 0) {
-            *out = *first_1;
-            ++out;
-            ++first_1;
-            ++first_2;
-            if (first_1 == last_1 || first_2 == last_2) return out;
-        } else if (result < 0) {
-            ++first_1;
-            if (first_1 == last_1) return out;
-        } else if (result > 0) {
-            ++first_2;
-            if (first_2 == last_2) return out;
+        // A child is on the opposite level kind and has no descendants to check.
+        if (best < grandchild) return;
+
+        size_t parent = (best - 1) >> 1;
+        if (NS(_minmax_heap_before)(first + parent, first + best, is_max, compare, compare_ctx)) {
+            NS(swap)(first + parent, first + best);
         }
+        index = best;
     }
 }
 
-ALGDEF T *NS(min)(
-        const T* a,
-        const T* b,
-        int (*cmp)(const T*, const T*, void*),
-        void* ctx
+ALGDEF void NS(push_minmax_heap)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (cmp(b, a, ctx) < 0) {
-        return (T*)b;
+    size_t count = last - first;
+    if (count <= 1) return;
+
+    size_t index = count - 1;
+    size_t parent = (index - 1) >> 1;
+    int is_max = NS(_minmax_heap_is_max_level)(index);
+
+    // If the new element belongs on the opposite level kind, move it up one level first.
+    if (NS(_minmax_heap_before)(first + parent, first + index, is_max, compare, compare_ctx)) {
+        NS(swap)(first + parent, first + index);
+        NS(_minmax_heap_bubble_up)(first, parent, !is_max, compare, compare_ctx);
     } else {
-        return (T*)a;
+        NS(_minmax_heap_bubble_up)(first, index, is_max, compare, compare_ctx);
     }
 }
 
-ALGDEF T *NS(max)(
-        const T *a,
-        const T *b,
-        int (*cmp)(const T*, const T*, void*),
-        void* ctx
+ALGDEF void NS(pop_minmax_heap_min)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (cmp(a, b, ctx) > 0) {
-        return (T*)a;
-    } else {
-        return (T*)b;
-    }
+    size_t count = last - first;
+    if (count <= 1) return;
+
+    --count;
+    NS(swap)(first, first + count);
+    NS(_minmax_heap_trickle_down)(first, count, 0, 0, compare, compare_ctx);
 }
 
-ALGDEF T *NS(min_element)(
-        const T *first,
-        const T *last,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+ALGDEF void NS(pop_minmax_heap_max)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (first == last) return (T*)last;
+    size_t count = last - first;
+    if (count <= 2) return;
 
-    const T* best = first;
-    ++first;
+    --count;
+    T *max = NS(minmax_heap_max)(first, last, compare, compare_ctx);
+    if (max == first + count) return;
 
-    while (first != last) {
-        if (cmp(first, best, cmp_ctx) < 0) {
-            best = first;
-        }
-        ++first;
-    }
-    return (T*)best;
+    NS(swap)(max, first + count);
+    NS(_minmax_heap_trickle_down)(first, count, max - first, 1, compare, compare_ctx);
 }
 
-ALGDEF T *NS(max_element)(
+ALGDEF T *NS(minmax_heap_max)(
         const T *first,
         const T *last,
-        int (*cmp)(const T*, const T*, void*),
-        void* ctx
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (first == last) return (T*)first;
+    size_t count = last - first;
+    if (count <= 2) {
+        return count == 0 ? (T*)last : (T*)(last - 1);
+    }
+    return compare(first + 2, first + 1, compare_ctx) > 0 ? (T*)(first + 2) : (T*)(first + 1);
+}
 
-    const T* best = first;
-    ++first;
+ALGDEF void NS(make_minmax_heap)(
+        T *first,
+        T *last,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    size_t count = last - first;
 
-    while (first != last) {
-        if (cmp(first, best, ctx) > 0) best = first;
-        ++first;
+    size_t i = count >> 1;
+    while (i != 0) {
+        --i;
+        NS(_minmax_heap_trickle_down)(first, count, i, NS(_minmax_heap_is_max_level)(i), compare, compare_ctx);
     }
-    return (T*)best;
 }
 
-ALGDEF void NS(minmax_element)(
+ALGDEF int NS(is_minmax_heap)(
         const T *first,
         const T *last,
-        T** out_min,
-        T** out_max,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (first == last) return;
-    const T *min_p = first;
-    ++first;
+    size_t count = last - first;
 
-    if (first == last) {
-        *out_min = (T*)min_p;
-        *out_max = (T*)min_p;
-        return;
-    }
+    // Comparing each node with its parent and grandparent is enough to order all descendants.
+    for (size_t i = 1; i < count; ++i) {
+        size_t parent = (i - 1) >> 1;
+        int parent_is_max = NS(_minmax_heap_is_max_level)(parent);
+        if (NS(_minmax_heap_before)(first + i, first + parent, parent_is_max, compare, compare_ctx)) {
+            return 0;
+        }
 
-    const T *max_p = first;
-    if (cmp(max_p, min_p, cmp_ctx) < 0) {
-        const T* temp = min_p;
-        min_p = max_p;
-        max_p = temp;
+        if (parent == 0) continue;
+        size_t grandparent = (parent - 1) >> 1;
+        if (NS(_minmax_heap_before)(first + i, first + grandparent, !parent_is_max, compare, compare_ctx)) {
+            return 0;
+        }
     }
+    return 1;
+}
 
-    ++first;
-
-    while (first != last && first + 1 != last) {
-        const T *potential_min = first;
-        const T *potential_max = first + 1;
+#ifdef ARRAY_ALG_KEY
+static size_t NS(_radix_heap_bucket)(const T *x, uint64_t last_key) {
+    uint64_t key = ARRAY_ALG_KEY(x);
+    assert(key >= last_key);
+    return array_alg_bit_width(key ^ last_key);
+}
 
-        if (cmp(potential_max, potential_min, cmp_ctx) < 0) {
-            const T* temp = potential_min;
-            potential_min = potential_max;
-            potential_max = temp;
-        }
+/// Move the elements of [first + bounds[top + 1], last) into buckets [0, top].
+/// requires:
+/// - every element belongs to a bucket <= top
+static void NS(_radix_heap_distribute)(
+        T *first,
+        T *last,
+        size_t top,
+        array_alg_radix_heap *heap
+        ) {
+    size_t *bounds = heap->bounds;
+    size_t counts[ARRAY_ALG_RADIX_HEAP_BUCKETS] = { 0 };
+    size_t next[ARRAY_ALG_RADIX_HEAP_BUCKETS];
 
-        if (cmp(potential_min, min_p, cmp_ctx) < 0) {
-            min_p = potential_min;
-        }
+    for (T *p = first + bounds[top + 1]; p != last; ++p) {
+        ++counts[NS(_radix_heap_bucket)(p, heap->last_key)];
+    }
 
-        if (cmp(potential_max, max_p, cmp_ctx) >= 0) {
-            max_p = potential_max;
-        }
-        ++first;
-        ++first;
+    size_t end = bounds[top + 1];
+    size_t b = top + 1;
+    while (b != 0) {
+        --b;
+        next[b] = end;
+        end += counts[b];
+        bounds[b] = end;
     }
 
-    if (first != last) {
-        if (cmp(first, min_p, cmp_ctx) < 0) {
-            min_p = first;
-        } else if (cmp(first, max_p, cmp_ctx) >= 0) {
-            max_p = first;
+    // Cycle each element into its bucket, like an American flag sort.
+    b = top + 1;
+    while (b != 0) {
+        --b;
+        while (next[b] != bounds[b]) {
+            size_t target = NS(_radix_heap_bucket)(first + next[b], heap->last_key);
+            if (target == b) {
+                ++next[b];
+            } else {
+                NS(swap)(first + next[b], first + next[target]);
+                ++next[target];
+            }
         }
     }
-    *out_min = (T*)min_p;
-    *out_max = (T*)max_p;
 }
 
-ALGDEF int NS(is_partitioned)(
-        const T *first, 
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
-        ) {
-    first = NS(find_if_not)(first, last, predicate, predicate_ctx);
-    first = NS(find_if)(first, last, predicate, predicate_ctx);
-    return first == last;
-}
-
-ALGDEF T *NS(partition)(
+ALGDEF void NS(make_radix_heap)(
         T *first,
         T *last,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
-        )
-{
-    T* out = first;
+        array_alg_radix_heap *heap
+        ) {
+    memset(heap, 0, sizeof(array_alg_radix_heap));
+    if (first == last) return;
 
-    while (first != last)
-    {
-        if (predicate(first, predicate_ctx))
-        {
-            NS(swap)(out, first);
-            ++out;
-        }
-        ++first;
+    uint64_t min_key = ARRAY_ALG_KEY(first);
+    for (const T *p = first + 1; p != last; ++p) {
+        uint64_t key = ARRAY_ALG_KEY(p);
+        if (key < min_key) min_key = key;
     }
-    return out;
+    heap->last_key = min_key;
+    NS(_radix_heap_distribute)(first, last, ARRAY_ALG_RADIX_HEAP_BUCKETS - 1, heap);
 }
 
-ALGDEF T *NS(stable_partition_with_buffer)(
+ALGDEF void NS(push_radix_heap)(
         T *first,
         T *last,
-        T *buffer,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
-        )
-{
-    T *out_false = buffer;
-    T *out_true = first;
-    NS(partition_copy)(first, last, &out_true, &out_false, predicate, predicate_ctx);
-    memcpy(out_true, buffer, sizeof(T) * (out_false - buffer));
-    return out_true;
+        array_alg_radix_heap *heap
+        ) {
+    size_t *bounds = heap->bounds;
+    size_t hole = last - first - 1;
+    assert(hole == bounds[0]);
+
+    T x = first[hole];
+    size_t bucket = NS(_radix_heap_bucket)(&x, heap->last_key);
+
+    // Make room at the end of the bucket by moving the first element
+    // of each smaller bucket to its end.
+    for (size_t b = 0; b < bucket; ++b) {
+        first[hole] = first[bounds[b + 1]];
+        hole = bounds[b + 1];
+        ++bounds[b];
+    }
+    first[hole] = x;
+    ++bounds[bucket];
 }
 
-ALGDEF T *NS(stable_partition)(
+ALGDEF void NS(pop_radix_heap)(
         T *first,
         T *last,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
-        )
-{
-    // TODO: this is not the best implementation 
-    if (first == last) return last;
-    T *buffer = malloc((last - first) * sizeof(T));
-    T *point = NS(stable_partition_with_buffer)(first, last, buffer, predicate, predicate_ctx);
-    free(buffer);
-    return point;
-}
-
-ALGDEF void NS(partition_copy)(
-        const T *first,
-        const T *last,
-        T **out_true,
-        T **out_false,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
+        array_alg_radix_heap *heap
         ) {
-
-    while (first != last)
-    {
-        if (predicate(first, predicate_ctx))
-        {
-            *(*out_true) = *first;
-            ++(*out_true);
-        }
-        else
-        {
-            *(*out_false) = *first;
-            ++(*out_false);
+    size_t *bounds = heap->bounds;
+    size_t count = last - first;
+    assert(count == bounds[0]);
+    if (count == 0) return;
+
+    // Bucket 0 holds keys equal to the last key popped, and is at the end.
+    if (bounds[1] == count) {
+        size_t bucket = 1;
+        while (bounds[bucket + 1] == count) ++bucket;
+
+        T *bucket_first = first + bounds[bucket + 1];
+        uint64_t min_key = ARRAY_ALG_KEY(bucket_first);
+        for (const T *p = bucket_first + 1; p != last; ++p) {
+            uint64_t key = ARRAY_ALG_KEY(p);
+            if (key < min_key) min_key = key;
         }
-        ++first;
+        heap->last_key = min_key;
+
+        // Every key in the bucket shares the bits above (bucket - 1)
+        // with the new last key, so they all move to smaller buckets.
+        bounds[bucket] = bounds[bucket + 1];
+        NS(_radix_heap_distribute)(first, last, bucket - 1, heap);
     }
+    --bounds[0];
 }
+#endif
 
-
-ALGDEF T *NS(partition_point_n)(
-        const T *first,
-        size_t n,
-        int (*predicate)(const T*, void*),
-        void* predicate_ctx
+#ifdef ARRAY_ALG_THREADS
+ALGDEF int NS(multiqueue_init)(
+        array_alg_multiqueue *mq,
+        size_t queue_count,
+        size_t capacity
         ) {
-    while (n) {
-        size_t half = n >> 1;
-        const T* middle = first + half;
+    // Push and pop pick a heap modulo queue_count.
+    if (queue_count == 0) return 0;
 
-        if (predicate(middle, predicate_ctx)) {
-            ++middle;
-            first = middle;
-            n -= (half + 1);
-        } else {
-            n = half;
+    mq->queue_count = queue_count;
+    mq->capacity = capacity;
+    mq->heaps = malloc(queue_count * capacity * sizeof(T));
+    mq->slots = malloc(queue_count * sizeof(array_alg_multiqueue_slot));
+
+    if (!mq->heaps || !mq->slots) {
+        free(mq->heaps);
+        free(mq->slots);
+        return 0;
+    }
+
+    for (size_t i = 0; i < queue_count; ++i) {
+        if (pthread_mutex_init(&mq->slots[i].queue.lock, NULL) != 0) {
+            while (i-- > 0) pthread_mutex_destroy(&mq->slots[i].queue.lock);
+            free(mq->heaps);
+            free(mq->slots);
+            return 0;
         }
+        mq->slots[i].queue.size = 0;
     }
-    return (T*)first;
+    return 1;
 }
 
-ALGDEF T *NS(partition_point)(
-        const T *first,
-        const T *last,
-        int (*predicate)(const T*, void*),
-        void *predicate_ctx
+ALGDEF void NS(multiqueue_free)(
+        array_alg_multiqueue *mq
         ) {
-    return NS(partition_point_n)(first, last - first, predicate, predicate_ctx);
+    for (size_t i = 0; i < mq->queue_count; ++i) {
+        pthread_mutex_destroy(&mq->slots[i].queue.lock);
+    }
+    free(mq->heaps);
+    free(mq->slots);
 }
 
-ALGDEF T *NS(is_sorted_until)(
-        const T* first,
-        const T* last,
+ALGDEF int NS(multiqueue_push)(
+        array_alg_multiqueue *mq,
+        const T *value,
+        uint64_t *seed,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    if (first != last)
-    {
-        const T* prev = first;
-        const T* next = prev;
-        ++next;
+    size_t full = 0;
 
-        while (next != last)
-        {
-            if (compare(prev, next, compare_ctx) > 0) return (T*)next;
-            prev = next;
-            ++next;
+    while (full < mq->queue_count) {
+        size_t i = array_alg_random_u64(seed) % mq->queue_count;
+        array_alg_multiqueue_slot *slot = mq->slots + i;
+
+        if (pthread_mutex_trylock(&slot->queue.lock) != 0) continue;
+
+        if (slot->queue.size == mq->capacity) {
+            pthread_mutex_unlock(&slot->queue.lock);
+            ++full;
+            continue;
         }
+
+        T *heap = (T*)mq->heaps + i * mq->capacity;
+        heap[slot->queue.size] = *value;
+        ++slot->queue.size;
+        NS(push_heap_n)(heap, slot->queue.size, compare, compare_ctx);
+        pthread_mutex_unlock(&slot->queue.lock);
+        return 1;
     }
-    return (T*)last;
+
+    // Random picks keep finding full heaps, so check them all.
+    // Heaps held by another thread may be changing, so sweep again until none were skipped.
+    size_t busy;
+    do {
+        busy = 0;
+        for (size_t i = 0; i < mq->queue_count; ++i) {
+            array_alg_multiqueue_slot *slot = mq->slots + i;
+            if (pthread_mutex_trylock(&slot->queue.lock) != 0) {
+                ++busy;
+                continue;
+            }
+
+            if (slot->queue.size < mq->capacity) {
+                T *heap = (T*)mq->heaps + i * mq->capacity;
+                heap[slot->queue.size] = *value;
+                ++slot->queue.size;
+                NS(push_heap_n)(heap, slot->queue.size, compare, compare_ctx);
+                pthread_mutex_unlock(&slot->queue.lock);
+                return 1;
+            }
+            pthread_mutex_unlock(&slot->queue.lock);
+        }
+    } while (busy != 0);
+    return 0;
 }
 
-ALGDEF int NS(is_sorted)(
-        const T *first,
-        const T *last,
+static void NS(_multiqueue_pop_locked)(
+        array_alg_multiqueue *mq,
+        size_t i,
+        T *out,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    return NS(is_sorted_until)(first, last, compare, compare_ctx) == last;
-}
-
-typedef struct {
-    const T* value;
-    int (*compare)(const T*, const T*, void*);
-    void* compare_ctx;
-} NS(_lower_upper_bound_closure);
+    array_alg_multiqueue_slot *slot = mq->slots + i;
+    T *heap = (T*)mq->heaps + i * mq->capacity;
 
-static int NS(_lower_bound_predicate)(const T* x, void* ctx) {
-    const NS(_lower_upper_bound_closure)* c = ctx;
-    return c->compare(x, c->value, c->compare_ctx) < 0;
+    NS(pop_heap_n)(heap, slot->queue.size, compare, compare_ctx);
+    --slot->queue.size;
+    *out = heap[slot->queue.size];
 }
 
-ALGDEF T *NS(lower_bound)(
-        const T *first,
-        const T *last,
-        const T* value,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+ALGDEF int NS(multiqueue_pop)(
+        array_alg_multiqueue *mq,
+        T *out,
+        uint64_t *seed,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
+    size_t empty = 0;
+
+    while (empty < mq->queue_count) {
+        size_t i = array_alg_random_u64(seed) % mq->queue_count;
+        size_t j = array_alg_random_u64(seed) % mq->queue_count;
+
+        if (pthread_mutex_trylock(&mq->slots[i].queue.lock) != 0) continue;
+
+        // Never wait for the second lock while holding the first.
+        if (j != i && pthread_mutex_trylock(&mq->slots[j].queue.lock) == 0) {
+            size_t size_i = mq->slots[i].queue.size;
+            size_t size_j = mq->slots[j].queue.size;
+            const T *top_i = (T*)mq->heaps + i * mq->capacity;
+            const T *top_j = (T*)mq->heaps + j * mq->capacity;
+
+            // Keep the better of the two locked as i.
+            if (size_i == 0 || (size_j != 0 && compare(top_j, top_i, compare_ctx) > 0)) {
+                pthread_mutex_unlock(&mq->slots[i].queue.lock);
+                i = j;
+            } else {
+                pthread_mutex_unlock(&mq->slots[j].queue.lock);
+            }
+        }
 
-    NS(_lower_upper_bound_closure) ctx = {
-        .value = value, 
-        .compare = cmp,
-        .compare_ctx = cmp_ctx
-    };
-    return NS(partition_point)(first, last, NS(_lower_bound_predicate), &ctx);
-}
+        if (mq->slots[i].queue.size == 0) {
+            pthread_mutex_unlock(&mq->slots[i].queue.lock);
+            ++empty;
+            continue;
+        }
 
-static int NS(_upper_bound_predicate)(const T* x, void* ctx) {
-    const NS(_lower_upper_bound_closure)* c = ctx;
-    return c->compare(c->value, x, c->compare_ctx) >= 0;
-}
+        NS(_multiqueue_pop_locked)(mq, i, out, compare, compare_ctx);
+        pthread_mutex_unlock(&mq->slots[i].queue.lock);
+        return 1;
+    }
 
-ALGDEF T *NS(upper_bound)(
-        const T *first,
-        const T *last,
-        const T *value,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
-        ) {
+    // Random picks keep finding empty heaps, so check them all.
+    // Heaps held by another thread may be changing, so sweep again until none were skipped.
+    size_t busy;
+    do {
+        busy = 0;
+        for (size_t i = 0; i < mq->queue_count; ++i) {
+            if (pthread_mutex_trylock(&mq->slots[i].queue.lock) != 0) {
+                ++busy;
+                continue;
+            }
 
-    NS(_lower_upper_bound_closure) ctx = {
-        .value = value, 
-        .compare = cmp,
-        .compare_ctx = cmp_ctx
-    };
-    return NS(partition_point)(first, last, NS(_upper_bound_predicate), &ctx);
+            if (mq->slots[i].queue.size != 0) {
+                NS(_multiqueue_pop_locked)(mq, i, out, compare, compare_ctx);
+                pthread_mutex_unlock(&mq->slots[i].queue.lock);
+                return 1;
+            }
+            pthread_mutex_unlock(&mq->slots[i].queue.lock);
+        }
+    } while (busy != 0);
+    return 0;
 }
 
-ALGDEF int NS(binary_search)(
-        const T *first,
-        const T *last,
-        const T *value,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
-        ) {
-    first = NS(lower_bound)(first, last, value, cmp, cmp_ctx);
-    return (first != last) && cmp(first, value, cmp_ctx) == 0;
-}
+#ifndef ARRAY_ALG_PARALLEL_
+#define ARRAY_ALG_PARALLEL_
+enum {
+    ARRAY_ALG_PARALLEL_MERGE,
+    ARRAY_ALG_PARALLEL_UNION,
+    ARRAY_ALG_PARALLEL_INTERSECTION,
+    ARRAY_ALG_PARALLEL_DIFFERENCE
+};
+#endif
 
-ALGDEF void NS(equal_range)(
-        const T *first,
-        const T *last,
-        const T *value,
-        T **lower,
-        T **upper,
-        int (*cmp)(const T*, const T*, void*),
-        void* cmp_ctx
+/// One part of a parallel merge or set operation.
+/// With out NULL, only the size of the result is found.
+typedef struct {
+    const T *first_1;
+    const T *last_1;
+    const T *first_2;
+    const T *last_2;
+    T *out;
+    size_t size;
+    int op;
+    int (*cmp)(const T*, const T*, void*);
+    void *cmp_ctx;
+} NS(_parallel_part);
+
+static void *NS(_parallel_part_run)(void *arg) {
+    NS(_parallel_part) *part = arg;
+    const T *first_1 = part->first_1;
+    const T *last_1 = part->last_1;
+    const T *first_2 = part->first_2;
+    const T *last_2 = part->last_2;
+
+    switch (part->op) {
+        case ARRAY_ALG_PARALLEL_MERGE:
+            NS(merge)(first_1, last_1, first_2, last_2, part->out, part->cmp, part->cmp_ctx);
+            break;
+        case ARRAY_ALG_PARALLEL_UNION:
+            if (part->out) {
+                NS(set_union)(first_1, last_1, first_2, last_2, part->out, part->cmp, part->cmp_ctx);
+            } else {
+                part->size = NS(set_union_size)(first_1, last_1, first_2, last_2, part->cmp, part->cmp_ctx);
+            }
+            break;
+        case ARRAY_ALG_PARALLEL_INTERSECTION:
+            part->size = NS(_set_intersection)(first_1, last_1, first_2, last_2, part->out, part->cmp, part->cmp_ctx);
+            break;
+        case ARRAY_ALG_PARALLEL_DIFFERENCE:
+            if (part->out) {
+                NS(set_difference)(first_1, last_1, first_2, last_2, part->out, part->cmp, part->cmp_ctx);
+            } else {
+                part->size = NS(set_difference_size)(first_1, last_1, first_2, last_2, part->cmp, part->cmp_ctx);
+            }
+            break;
+    }
+    return NULL;
+}
+
+/// Run parts 1 and up on new threads, and part 0 on this one.
+static void NS(_parallel_parts_run)(
+        NS(_parallel_part) *parts,
+        pthread_t *threads,
+        size_t count
         ) {
-    *lower = NS(lower_bound)(first, last, value, cmp, cmp_ctx);
-    *upper = NS(upper_bound)(*lower, last, value, cmp, cmp_ctx);
+    size_t started = 1;
+    while (started < count && pthread_create(threads + started, NULL, NS(_parallel_part_run), parts + started) == 0) {
+        ++started;
+    }
+    for (size_t i = started; i < count; ++i) NS(_parallel_part_run)(parts + i);
+    NS(_parallel_part_run)(parts);
+    for (size_t i = 1; i < started; ++i) pthread_join(threads[i], NULL);
 }
 
-ALGDEF int NS(next_permutation)(
-        T *first,
-        T *last,
+static T *NS(_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int op,
         int (*cmp)(const T*, const T*, void*),
         void* cmp_ctx
         ) {
+    size_t n = (last_1 - first_1) + (last_2 - first_2);
+    if (thread_count > n) thread_count = n;
+    if (thread_count == 0) thread_count = 1;
+
+    NS(_parallel_part) single;
+    NS(_parallel_part) *parts = malloc(thread_count * sizeof(NS(_parallel_part)));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    if (!parts || !threads) {
+        // Fall back to doing it all on this thread.
+        free(parts);
+        parts = &single;
+        thread_count = 1;
+    }
 
-    if (first == last) return 0;
-    T *l = last;
-    --l;
-
+    const T *split_1 = first_1;
+    const T *split_2 = first_2;
+    for (size_t t = 0; t < thread_count; ++t) {
+        const T *next_1 = last_1;
+        const T *next_2 = last_2;
+
+        if (t + 1 < thread_count) {
+            size_t diagonal = n * (t + 1) / thread_count;
+            next_1 = first_1 + NS(merge_path)(first_1, last_1, first_2, last_2, diagonal, cmp, cmp_ctx);
+            next_2 = first_2 + (diagonal - (next_1 - first_1));
+
+            if (op != ARRAY_ALG_PARALLEL_MERGE && (next_1 != last_1 || next_2 != last_2)) {
+                // Split before the next element in merge order, and every element equal to it.
+                const T *pivot = next_2 == last_2 || (next_1 != last_1 && cmp(next_1, next_2, cmp_ctx) < 0) ? next_1 : next_2;
+                next_1 = NS(lower_bound)(split_1, next_1, pivot, cmp, cmp_ctx);
+                next_2 = NS(lower_bound)(split_2, next_2, pivot, cmp, cmp_ctx);
+            }
+        }
 
-    T *next = l - 1;
-    while (l != first && cmp(next, l, cmp_ctx) >= 0)
-    {
-        l = next;
-        --next;
+        NS(_parallel_part) part = { split_1, next_1, split_2, next_2, NULL, 0, op, cmp, cmp_ctx };
+        parts[t] = part;
+        split_1 = next_1;
+        split_2 = next_2;
     }
 
-    if (l != first)
-    {
-        T *f = last - 1;
-        while (f != next && cmp(next, f, cmp_ctx) >= 0)
-        {
-            --f;
+    if (op == ARRAY_ALG_PARALLEL_MERGE) {
+        for (size_t t = 0; t < thread_count; ++t) {
+            parts[t].size = (parts[t].last_1 - parts[t].first_1) + (parts[t].last_2 - parts[t].first_2);
         }
-
-        NS(swap)(next, f);
-        NS(reverse)(l, last);
-        return 1;
+    } else {
+        NS(_parallel_parts_run)(parts, threads, thread_count);
     }
-    else
-    {
-        NS(reverse(first, last));
-        return 0;
+
+    for (size_t t = 0; t < thread_count; ++t) {
+        parts[t].out = out;
+        out += parts[t].size;
     }
-}
+    NS(_parallel_parts_run)(parts, threads, thread_count);
 
+    if (parts != &single) free(parts);
+    free(threads);
+    return out;
+}
 
-ALGDEF void NS(random_shuffle_n)(
-        T *first,
-        size_t n
+ALGDEF T *NS(merge_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    while (n > 1)
-    {
-        size_t j = ARRAY_ALG_RANDOM(n);
-        --n;
-        NS(swap)(first + n, first + j);
-    }
+    return NS(_parallel)(first_1, last_1, first_2, last_2, out, thread_count, ARRAY_ALG_PARALLEL_MERGE, compare, compare_ctx);
 }
 
-
-ALGDEF void NS(random_shuffle)(
-        T *first,
-        T *last
+ALGDEF T *NS(set_union_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
         ) {
-    NS(random_shuffle_n)(first, last - first);
+    return NS(_parallel)(first_1, last_1, first_2, last_2, out, thread_count, ARRAY_ALG_PARALLEL_UNION, cmp, cmp_ctx);
 }
 
-ALGDEF T* NS(sample)(
-        const T *first,
-        const T *last,
-        T* out,
-        size_t count
+ALGDEF T *NS(set_intersection_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
         ) {
-    for (size_t i = 0; i < count; ++i) {
-        if (first == last) {
-            return out + i;
-        }
-        out[i] = *first;
-        ++first;
-    }
-
-    size_t range = count + 1;
-    while (first != last) {
-        size_t j = ARRAY_ALG_RANDOM(range);
+    return NS(_parallel)(first_1, last_1, first_2, last_2, out, thread_count, ARRAY_ALG_PARALLEL_INTERSECTION, cmp, cmp_ctx);
+}
 
-        if (j < count) {
-            out[j] = *first;
-        }
-        ++first;
-        ++range;
-    }
-    return out + count;
+ALGDEF T *NS(set_difference_parallel)(
+        const T *first_1,
+        const T *last_1,
+        const T *first_2,
+        const T *last_2,
+        T *restrict out,
+        size_t thread_count,
+        int (*cmp)(const T*, const T*, void*),
+        void* cmp_ctx
+        ) {
+    return NS(_parallel)(first_1, last_1, first_2, last_2, out, thread_count, ARRAY_ALG_PARALLEL_DIFFERENCE, cmp, cmp_ctx);
 }
+#endif
 
-ALGDEF T *NS(is_heap_until)(
+#ifdef ARRAY_ALG_INDEX
+/// Move the element at index up toward the root until its parent is larger.
+static void NS(_sift_up_indexed)(
         T *first,
-        T *last,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
+        size_t index,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    T *half = first;
-    ++first;
+    T x = first[index];
 
-    while (1) {
-        if (first == last || compare(half, first, compare_ctx) < 0) {
-            return first;
-        }
-        ++first;
-        if (first == last || compare(half, first, compare_ctx) < 0) {
-            return first;
-        }
-        ++first;
-        ++half;
-    }
-    return first;
-}
+    while (index != 0) {
+        size_t parent_index = (index - 1) >> 1;
+        T *parent = first + parent_index;
 
+        if (compare(&x, parent, compare_ctx) <= 0) break;
 
-ALGDEF int NS(is_heap)(
-        T *first,
-        T *last,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
-        ) {
-    return NS(is_heap_until)(first, last, compare, compare_ctx) == last;
+        first[index] = *parent;
+        positions[ARRAY_ALG_INDEX(parent)] = index;
+        index = parent_index;
+    }
+    first[index] = x;
+    positions[ARRAY_ALG_INDEX(&x)] = index;
 }
 
-ALGDEF void NS(push_heap_n)(
+/// Move the element at index down toward the leaves until both children are smaller.
+static void NS(_sift_down_indexed)(
         T *first,
         size_t count,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
+        size_t index,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
         ) {
-    if (count <= 1) return;
+    T x = first[index];
 
-    size_t index = count - 1;
+    while (1) {
+        size_t child_index = index * 2 + 1;
+        if (child_index >= count) break;
 
-    while (index != 0) {
-        size_t parent_index = (index - 1) >> 1;
+        T *child = first + child_index;
+        if (child_index + 1 < count && compare(child + 1, child, compare_ctx) > 0) {
+            ++child_index;
+            ++child;
+        }
 
-        T* elem = first + index;
-        T* parent = first + parent_index;
+        if (compare(child, &x, compare_ctx) <= 0) break;
 
-        if (compare(elem, parent, compare_ctx) <= 0) {
-            break;
-        }
-        NS(swap)(elem, parent);
-        index = parent_index;
+        first[index] = *child;
+        positions[ARRAY_ALG_INDEX(child)] = index;
+        index = child_index;
     }
+    first[index] = x;
+    positions[ARRAY_ALG_INDEX(&x)] = index;
 }
 
-ALGDEF void NS(push_heap)(
+ALGDEF void NS(push_heap_indexed)(
         T *first,
         T *last,
-        int (*compare)(const T*, const T*, void *),
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    NS(push_heap_n)(first, last - first, compare, compare_ctx);
+    if (first == last) return;
+    NS(_sift_up_indexed)(first, (last - first) - 1, positions, compare, compare_ctx);
 }
 
-ALGDEF void NS(pop_heap_n)(
+ALGDEF void NS(pop_heap_indexed)(
         T *first,
-        size_t count,
-        int (*compare)(const T*, const T*, void *),
+        T *last,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    if (count <= 1) return;
+    if (first == last) return;
+    size_t count = (last - first) - 1;
 
-    --count;
-    T *end = first + count;
-    NS(swap)(first, end);
+    NS(swap)(first, first + count);
+    positions[ARRAY_ALG_INDEX(first + count)] = count;
+    if (count == 0) return;
+    NS(_sift_down_indexed)(first, count, 0, positions, compare, compare_ctx);
+}
 
-    size_t index = 0;
-    while (1) {
-        T *elem = first + index;
-        index = index * 2 + 1;
-        if (index >= count) break;
+ALGDEF void NS(make_heap_indexed)(
+        T *first,
+        T *last,
+        size_t *positions,
+        int (*compare)(const T*, const T*, void*),
+        void *compare_ctx
+        ) {
+    size_t count = last - first;
 
-        T *child = first + index;
-        if (compare(child, elem, compare_ctx) > 0) {
-            // left child is larger
+    for (size_t i = 0; i < count; ++i) {
+        positions[ARRAY_ALG_INDEX(first + i)] = i;
+    }
 
-            // if right is larger use that 
-            if (index + 1 < count
-                    && compare(child + 1, child, compare_ctx) > 0) {
-                ++index;
-                ++child;
-            }
-        } else {
-            ++index;
-            ++child;
-            if (index >= count || compare(child, elem, compare_ctx) <= 0) {
-                break;
-            }
-            // right child is larger
-        }
-        NS(swap)(elem, child);
+    // Floyd's method: sift down every parent, starting from the bottom.
+    size_t i = count >> 1;
+    while (i != 0) {
+        --i;
+        NS(_sift_down_indexed)(first, count, i, positions, compare, compare_ctx);
     }
 }
 
-ALGDEF void NS(pop_heap)(
+ALGDEF void NS(increase_key_heap_indexed)(
         T *first,
         T *last,
-        int (*compare)(const T*, const T*, void *),
+        size_t *positions,
+        const T *value,
+        int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    return NS(pop_heap_n)(first, last - first, compare, compare_ctx);
-}
+    size_t index = positions[ARRAY_ALG_INDEX(value)];
+    assert(first + index < last);
 
-ALGDEF void NS(make_heap_n)(
-        T *first,
-        size_t count,
-        int (*compare)(const T*, const T*, void *),
-        void* compare_ctx
-        ) {
-    for (size_t n = 2; n <= count; ++n) {
-        NS(push_heap_n)(first, n, compare, compare_ctx);
-    }
+    first[index] = *value;
+    NS(_sift_up_indexed)(first, index, positions, compare, compare_ctx);
 }
 
-ALGDEF void NS(make_heap)(
+ALGDEF void NS(decrease_key_heap_indexed)(
         T *first,
         T *last,
+        size_t *positions,
+        const T *value,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    NS(make_heap_n)(first, last - first, compare, compare_ctx);
+    size_t index = positions[ARRAY_ALG_INDEX(value)];
+    assert(first + index < last);
+
+    first[index] = *value;
+    NS(_sift_down_indexed)(first, last - first, index, positions, compare, compare_ctx);
 }
 
-ALGDEF void NS(sort_heap)(
+ALGDEF void NS(erase_heap_indexed)(
         T *first,
         T *last,
+        size_t *positions,
+        size_t id,
         int (*compare)(const T*, const T*, void*),
         void *compare_ctx
         ) {
-    while (last != first) {
-        NS(pop_heap)(first, last, compare, compare_ctx);
-        --last;
+    size_t index = positions[id];
+    size_t count = (last - first) - 1;
+    assert(index <= count);
+
+    NS(swap)(first + index, first + count);
+    positions[id] = count;
+    if (index == count) return;
+
+    // The element moved into the hole may belong above or below it.
+    if (index != 0 && compare(first + index, first + ((index - 1) >> 1), compare_ctx) > 0) {
+        NS(_sift_up_indexed)(first, index, positions, compare, compare_ctx);
+    } else {
+        NS(_sift_down_indexed)(first, count, index, positions, compare, compare_ctx);
     }
 }
+#endif
 
 static void NS(_insertion_sort_unguarded)(
         T *restrict first,
@@ -2265,6 +6782,11 @@ ALGDEF T* NS(insert_n)(
     return last + n;
 }
 
+#endif
+#endif
+
+#ifdef ARRAY_ALG_COMPACT_LANES
+#undef ARRAY_ALG_COMPACT_LANES
 #endif
 
 #undef T
@@ -2282,6 +6804,34 @@ ALGDEF T* NS(insert_n)(
 #undef ARRAY_ALG_PREFIX
 #endif
 
+#ifdef ARRAY_ALG_INDEX
+#undef ARRAY_ALG_INDEX
+#endif
+
+#ifdef ARRAY_ALG_KEY
+#undef ARRAY_ALG_KEY
+#endif
+
+#ifdef ARRAY_ALG_PREDICATE
+#undef ARRAY_ALG_PREDICATE
+#endif
+
+#ifdef ARRAY_ALG_ARITHMETIC
+#undef ARRAY_ALG_ARITHMETIC
+#endif
+
+#ifdef ARRAY_ALG_INTEGER
+#undef ARRAY_ALG_INTEGER
+#endif
+
+#ifdef ARRAY_ALG_BYTEWISE_EQ
+#undef ARRAY_ALG_BYTEWISE_EQ
+#endif
+
+#ifdef ARRAY_ALG_BYTEWISE_ORDER
+#undef ARRAY_ALG_BYTEWISE_ORDER
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,8 @@
 
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(a[0]))
 
+#define ARRAY_ALG_THREADS
+
 typedef struct {
     int id;
     char name[32];
@@ -15,14 +17,61 @@ typedef struct {
 
 #define ARRAY_ALG_TYPE int
 #define ARRAY_ALG_PREFIX intv_
+#define ARRAY_ALG_KEY(x) ((uint64_t)((uint32_t)*(x) ^ 0x80000000u))
+#define ARRAY_ALG_ARITHMETIC
+#define ARRAY_ALG_INTEGER
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE uint32_t
+#define ARRAY_ALG_PREFIX u32v_
+#define ARRAY_ALG_ARITHMETIC
+#define ARRAY_ALG_INTEGER
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE int
+#define ARRAY_ALG_PREFIX intv_even_
+#define ARRAY_ALG_PREDICATE(x) (*(x) % 2 == 0)
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE double
+#define ARRAY_ALG_PREFIX doublev_
+#define ARRAY_ALG_ARITHMETIC
+#include "../array_alg.h"
+
+// Small instantiations to cover each width of the SIMD scans.
+#define ARRAY_ALG_TYPE int8_t
+#define ARRAY_ALG_PREFIX int8v_
+#define ARRAY_ALG_ARITHMETIC
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE uint16_t
+#define ARRAY_ALG_PREFIX u16v_
+#define ARRAY_ALG_ARITHMETIC
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE int64_t
+#define ARRAY_ALG_PREFIX int64v_
+#define ARRAY_ALG_ARITHMETIC
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE float
+#define ARRAY_ALG_PREFIX floatv_
+#define ARRAY_ALG_ARITHMETIC
 #include "../array_alg.h"
 
 #define ARRAY_ALG_TYPE char
 #define ARRAY_ALG_PREFIX string_
+#define ARRAY_ALG_BYTEWISE_EQ
+#include "../array_alg.h"
+
+#define ARRAY_ALG_TYPE unsigned char
+#define ARRAY_ALG_PREFIX bytes_
+#define ARRAY_ALG_BYTEWISE_ORDER
 #include "../array_alg.h"
 
 #define ARRAY_ALG_TYPE Person
 #define ARRAY_ALG_PREFIX person_array_
+#define ARRAY_ALG_INDEX(x) ((size_t)(x)->id)
 #include "../array_alg.h"
 
 // Import private functions for testing. 
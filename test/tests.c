@@ -1,6 +1,8 @@
 #include "defs.h"
 #include <assert.h>
 #include <time.h>
+#include <limits.h>
+#include <math.h>
 
 static
 void print_array(int* x, int n) {
@@ -23,6 +25,11 @@ int compare_char(const char* a, const char* b, void* ctx) {
     return (*a) - (*b);
 }
 
+static
+int compare_byte(const unsigned char* a, const unsigned char* b, void* ctx) {
+    return (*a) - (*b);
+}
+
 static
 int compare_int(const int* a, const int* b, void* ctx) {
     return *a - *b;
@@ -127,10 +134,11 @@ void test_copy_backward(void) {
     int numbers[] = { 1, 2, 3, 4, 5, 6 };
     {
         // shift up by one 
-        intv_copy_backward(numbers, numbers + 5, numbers + 6);
+        int* start = intv_copy_backward(numbers, numbers + 5, numbers + 6);
         print_array(numbers, 6);
         int expected[] = { 1, 1, 2, 3, 4, 5 };
         assert(memcmp(numbers, expected, 6 * sizeof(int)) == 0);
+        assert(start == numbers + 1);
     }
 }
 
@@ -141,6 +149,13 @@ void test_compare(void) {
     {
         assert(string_equal(word1, word1 + 3,  word2, compare_char, NULL));
         assert(!string_equal(word1, word1 + 4, word2, compare_char, NULL));
+
+        // Equality is a memcmp, including bytes above 0x7f and empty ranges.
+        const char* accented1 = "caf\xe9s";
+        const char* accented2 = "caf\xe9!";
+        assert(string_equal(accented1, accented1 + 4, accented2, compare_char, NULL));
+        assert(!string_equal(accented1, accented1 + 5, accented2, compare_char, NULL));
+        assert(string_equal(accented1, accented1, word1, compare_char, NULL));
     }
 
     {
@@ -150,6 +165,22 @@ void test_compare(void) {
                 compare_char, NULL
                 );
         assert(result == strcmp(word1, word2));
+
+        // A prefix orders first.
+        assert(string_lexicographical_compare(word1, word1 + 3, word2, word2 + 4, compare_char, NULL) < 0);
+        assert(string_lexicographical_compare(word1, word1 + 4, word2, word2 + 3, compare_char, NULL) > 0);
+        assert(string_lexicographical_compare(word1, word1 + 3, word2, word2 + 3, compare_char, NULL) == 0);
+    }
+
+    {
+        // Bytes above 0x7f order after ASCII, like memcmp.
+        const unsigned char bytes1[] = { 'a', 0x80, 'b' };
+        const unsigned char bytes2[] = { 'a', 0x7f, 'b', 'c' };
+        assert(bytes_lexicographical_compare(bytes1, bytes1 + 3, bytes2, bytes2 + 3, compare_byte, NULL) > 0);
+        assert(bytes_lexicographical_compare(bytes2, bytes2 + 4, bytes1, bytes1 + 3, compare_byte, NULL) < 0);
+        assert(bytes_lexicographical_compare(bytes2, bytes2 + 3, bytes2, bytes2 + 4, compare_byte, NULL) < 0);
+        assert(bytes_equal(bytes1, bytes1 + 1, bytes2, compare_byte, NULL));
+        assert(!bytes_equal(bytes1, bytes1 + 3, bytes2, compare_byte, NULL));
     }
 }
 
@@ -175,6 +206,18 @@ void test_swap(void) {
         assert(strcmp(dog, "cat") == 0);
         assert(strcmp(cat, "dog") == 0);
     }
+    {
+        // Longer than one block.
+        int a[1000];
+        int b[1000];
+        for (int i = 0; i < 1000; ++i) {
+            a[i] = i;
+            b[i] = -i;
+        }
+        assert(intv_swap_ranges(a, a + 999, b) == b + 999);
+        for (int i = 0; i < 999; ++i) assert(a[i] == -i && b[i] == i);
+        assert(a[999] == 999 && b[999] == -999);
+    }
 }
 
 void test_reverse(void) {
@@ -194,6 +237,11 @@ void test_reverse(void) {
 
 }
 
+static
+int compare_quarter(const int* a, const int* b, void* ctx) {
+    return *a / 4 - *b / 4;
+}
+
 void test_merge(void) {
     {
         int a[] = { 1, 1, 3, 4 };
@@ -214,6 +262,29 @@ void test_merge(void) {
         int expected[] = { -1, 1, 1, 1, 2, 3, 3, 4, 4, 5 };
         assert(memcmp(a, expected, sizeof(expected)) == 0);
     }
+    {
+        enum { N = 200 };
+        int a[N];
+        int b[N];
+        int expected[2 * N];
+        int out[2 * N];
+
+        for (int iteration = 0; iteration < 200; ++iteration) {
+            // Compare by x / 4, so the order of equal elements shows.
+            int n_a = ARRAY_ALG_RANDOM(N);
+            int n_b = ARRAY_ALG_RANDOM(N);
+            for (int i = 0; i < n_a; ++i) a[i] = ARRAY_ALG_RANDOM(100);
+            for (int i = 0; i < n_b; ++i) b[i] = ARRAY_ALG_RANDOM(100);
+            intv_stable_sort(a, a + n_a, compare_quarter, NULL);
+            intv_stable_sort(b, b + n_b, compare_quarter, NULL);
+
+            int* end = intv_merge(a, a + n_a, b, b + n_b, expected, compare_quarter, NULL);
+            assert(intv_merge_branchless(a, a + n_a, b, b + n_b, out, compare_quarter, NULL) == out + (end - expected));
+            assert(memcmp(out, expected, (n_a + n_b) * sizeof(int)) == 0);
+            assert(intv_merge_bidirectional(a, a + n_a, b, b + n_b, out, compare_quarter, NULL) == out + (end - expected));
+            assert(memcmp(out, expected, (n_a + n_b) * sizeof(int)) == 0);
+        }
+    }
 }
 
 void test_remove(void) {
@@ -257,6 +328,14 @@ void test_fill(void) {
     }
     assert(nums[3] == -10);
     assert(nums[4] == -10);
+
+    // Repeated bytes fill with memset.
+    x = -1;
+    intv_fill(nums, nums + 4, &x);
+    for (int i = 0; i < 4; ++i) {
+        assert(nums[i] == -1);
+    }
+    assert(nums[4] == -10);
 }
 
 
@@ -327,6 +406,130 @@ void test_difference(void) {
     int expected[] = { 4, 7 };
     assert(end - start == 2);
     assert(memcmp(start, expected, sizeof(expected)) == 0);
+
+    {
+        // The rest of a is moved down over itself.
+        int c[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        int d[] = { 1 };
+        end = intv_set_difference(c, c + 8, d, d + 1, c, compare_int, NULL);
+        int expected_c[] = { 2, 3, 4, 5, 6, 7, 8 };
+        assert(end == c + 7);
+        assert(memcmp(c, expected_c, sizeof(expected_c)) == 0);
+    }
+}
+
+void test_skewed_sets(void) {
+    enum { N = 2000, VALUES = 40 };
+    static int a[N];
+    static int b[N];
+    static int out[2 * N];
+    int count_a[VALUES];
+    int count_b[VALUES];
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        // Sizes from equal up to far past ARRAY_ALG_GALLOP_RATIO apart, in either order.
+        int n_a = ARRAY_ALG_RANDOM(N);
+        int n_b = ARRAY_ALG_RANDOM(N) >> ARRAY_ALG_RANDOM(12);
+        if (iteration & 1) {
+            int temp = n_a;
+            n_a = n_b;
+            n_b = temp;
+        }
+
+        memset(count_a, 0, sizeof(count_a));
+        memset(count_b, 0, sizeof(count_b));
+        for (int i = 0; i < n_a; ++i) ++count_a[a[i] = ARRAY_ALG_RANDOM(VALUES)];
+        for (int i = 0; i < n_b; ++i) ++count_b[b[i] = ARRAY_ALG_RANDOM(VALUES)];
+        intv_sort(a, a + n_a, compare_int, NULL);
+        intv_sort(b, b + n_b, compare_int, NULL);
+
+        int* end = intv_set_intersection(a, a + n_a, b, b + n_b, out, compare_int, NULL);
+        int* p = out;
+        for (int x = 0; x < VALUES; ++x) {
+            for (int i = 0; i < count_a[x] && i < count_b[x]; ++i) assert(*p++ == x);
+        }
+        assert(p == end);
+
+        end = intv_set_difference(a, a + n_a, b, b + n_b, out, compare_int, NULL);
+        p = out;
+        for (int x = 0; x < VALUES; ++x) {
+            for (int i = count_b[x]; i < count_a[x]; ++i) assert(*p++ == x);
+        }
+        assert(p == end);
+
+        size_t intersection_size = 0;
+        size_t difference_size = 0;
+        for (int x = 0; x < VALUES; ++x) {
+            intersection_size += count_a[x] < count_b[x] ? count_a[x] : count_b[x];
+            difference_size += count_a[x] > count_b[x] ? count_a[x] - count_b[x] : 0;
+        }
+        size_t union_size = n_a + n_b - intersection_size;
+        assert(intv_set_intersection_size(a, a + n_a, b, b + n_b, compare_int, NULL) == intersection_size);
+        assert(intv_set_union_size(a, a + n_a, b, b + n_b, compare_int, NULL) == union_size);
+        assert(intv_set_difference_size(a, a + n_a, b, b + n_b, compare_int, NULL) == difference_size);
+        assert(intv_set_union(a, a + n_a, b, b + n_b, out, compare_int, NULL) - out == (long)union_size);
+
+        size_t stats[3];
+        intv_set_stats(a, a + n_a, b, b + n_b, stats, stats + 1, stats + 2, compare_int, NULL);
+        assert(stats[0] == intersection_size && stats[1] == union_size && stats[2] == difference_size);
+
+        int includes = 1;
+        for (int x = 0; x < VALUES; ++x) includes = includes && count_b[x] <= count_a[x];
+        assert(intv_set_includes(b, b + n_b, a, a + n_a, compare_int, NULL) == includes);
+
+        // A subset which is always included.
+        int n_sub = 0;
+        for (int i = 0; i < n_a; i += 1 + ARRAY_ALG_RANDOM(64)) out[n_sub++] = a[i];
+        assert(intv_set_includes(out, out + n_sub, a, a + n_a, compare_int, NULL));
+
+        // In place difference.
+        end = intv_set_difference(a, a + n_a, b, b + n_b, a, compare_int, NULL);
+        p = a;
+        for (int x = 0; x < VALUES; ++x) {
+            for (int i = count_b[x]; i < count_a[x]; ++i) assert(*p++ == x);
+        }
+        assert(p == end);
+    }
+}
+
+void test_sets_k(void) {
+    enum { K = 8, N = 500, VALUES = 30 };
+    static int arrays[K][N];
+    static int out[K * N];
+    const int* firsts[K];
+    const int* lasts[K];
+    int counts[K][VALUES];
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        size_t k = ARRAY_ALG_RANDOM(K + 1);
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < k; ++i) {
+            // Mix tiny and large ranges so the intersection gallops.
+            int n = ARRAY_ALG_RANDOM(N) >> ARRAY_ALG_RANDOM(8);
+            for (int j = 0; j < n; ++j) ++counts[i][arrays[i][j] = ARRAY_ALG_RANDOM(VALUES)];
+            intv_sort(arrays[i], arrays[i] + n, compare_int, NULL);
+            firsts[i] = arrays[i];
+            lasts[i] = arrays[i] + n;
+        }
+
+        int* end = intv_set_intersection_k(firsts, lasts, k, out, compare_int, NULL);
+        int* p = out;
+        for (int x = 0; x < VALUES && k > 0; ++x) {
+            int least = counts[0][x];
+            for (size_t i = 1; i < k; ++i) least = counts[i][x] < least ? counts[i][x] : least;
+            for (int j = 0; j < least; ++j) assert(*p++ == x);
+        }
+        assert(p == end);
+
+        end = intv_set_union_k(firsts, lasts, k, out, compare_int, NULL);
+        p = out;
+        for (int x = 0; x < VALUES; ++x) {
+            int most = 0;
+            for (size_t i = 0; i < k; ++i) most = counts[i][x] > most ? counts[i][x] : most;
+            for (int j = 0; j < most; ++j) assert(*p++ == x);
+        }
+        assert(p == end);
+    }
 }
 
 void test_minmax(void) {
@@ -464,6 +667,418 @@ void test_binary_search(void) {
     }
 }
 
+void test_bounds(void) {
+    enum { N = 64 };
+    int nums[N];
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        int n = ARRAY_ALG_RANDOM(N);
+        for (int i = 0; i < n; ++i) nums[i] = ARRAY_ALG_RANDOM(20);
+        intv_sort(nums, nums + n, compare_int, NULL);
+
+        for (int x = -1; x <= 21; ++x) {
+            int lower = 0;
+            while (lower < n && nums[lower] < x) ++lower;
+            int upper = lower;
+            while (upper < n && nums[upper] <= x) ++upper;
+
+            assert(intv_lower_bound(nums, nums + n, &x, compare_int, NULL) == nums + lower);
+            assert(intv_upper_bound(nums, nums + n, &x, compare_int, NULL) == nums + upper);
+            assert(intv_binary_search(nums, nums + n, &x, compare_int, NULL) == (lower != upper));
+
+            int* equal_lower;
+            int* equal_upper;
+            intv_equal_range(nums, nums + n, &x, &equal_lower, &equal_upper, compare_int, NULL);
+            assert(equal_lower == nums + lower);
+            assert(equal_upper == nums + upper);
+            assert(intv_count_equal(nums, nums + n, &x, compare_int, NULL) == (size_t)(upper - lower));
+        }
+    }
+}
+
+void test_eytzinger(void) {
+    enum { N = 100 };
+    int nums[N];
+    int eytzinger[N + 1];
+
+    for (int n = 0; n <= N; ++n) {
+        for (int i = 0; i < n; ++i) nums[i] = ARRAY_ALG_RANDOM(50);
+        intv_sort(nums, nums + n, compare_int, NULL);
+        intv_eytzinger_build(nums, nums + n, eytzinger);
+
+        for (int x = -1; x <= 51; ++x) {
+            size_t expected = intv_lower_bound(nums, nums + n, &x, compare_int, NULL) - nums;
+            assert(intv_eytzinger_lower_bound(eytzinger, n, &x, compare_int, NULL) == expected);
+        }
+    }
+}
+
+static
+int compare_u32(const uint32_t* a, const uint32_t* b, void* ctx) {
+    return (*a > *b) - (*a < *b);
+}
+
+static
+int compare_double(const double* a, const double* b, void* ctx) {
+    return (*a > *b) - (*a < *b);
+}
+
+void test_stree(void) {
+    enum { N = 1000 };
+    static int nums[N];
+    static int stree[N * 2];
+    static uint32_t u32_nums[N];
+    static uint32_t u32_stree[N * 2];
+    static double double_nums[N];
+    static double double_stree[N * 2];
+
+    for (int n = 0; n <= N; n += 1 + n / 4) {
+        assert(intv_stree_size(n) <= N * 2);
+
+        for (int i = 0; i < n; ++i) nums[i] = (int)ARRAY_ALG_RANDOM(200) - 100;
+        intv_sort(nums, nums + n, compare_int, NULL);
+        intv_stree_build(nums, nums + n, stree);
+
+        for (int i = 0; i < n; ++i) u32_nums[i] = 0xFFFFFF00u + (uint32_t)ARRAY_ALG_RANDOM(200);
+        u32v_sort(u32_nums, u32_nums + n, compare_u32, NULL);
+        u32v_stree_build(u32_nums, u32_nums + n, u32_stree);
+
+        for (int i = 0; i < n; ++i) double_nums[i] = ARRAY_ALG_RANDOM(200) * 0.5;
+        doublev_sort(double_nums, double_nums + n, compare_double, NULL);
+        doublev_stree_build(double_nums, double_nums + n, double_stree);
+
+        for (int x = -102; x <= 102; ++x) {
+            size_t expected = intv_lower_bound(nums, nums + n, &x, compare_int, NULL) - nums;
+            assert(intv_stree_lower_bound(stree, n, &x) == expected);
+
+            uint32_t u = 0xFFFFFF00u + (uint32_t)x;
+            expected = u32v_lower_bound(u32_nums, u32_nums + n, &u, compare_u32, NULL) - u32_nums;
+            assert(u32v_stree_lower_bound(u32_stree, n, &u) == expected);
+
+            double d = x * 0.75;
+            expected = doublev_lower_bound(double_nums, double_nums + n, &d, compare_double, NULL) - double_nums;
+            assert(doublev_stree_lower_bound(double_stree, n, &d) == expected);
+        }
+    }
+}
+
+void test_set_intersection_simd(void) {
+    enum { N = 300 };
+    static int a[N];
+    static int b[N];
+    static int expected[N];
+    static int out[N];
+    static uint32_t u32_a[N];
+    static uint32_t u32_b[N];
+    static uint32_t u32_expected[N];
+    static uint32_t u32_out[N];
+
+    for (int iteration = 0; iteration < 500; ++iteration) {
+        // Small value ranges give dense overlaps, large ones sparse.
+        int values = 1 + ARRAY_ALG_RANDOM(4 * N);
+        int n_a = ARRAY_ALG_RANDOM(N);
+        int n_b = ARRAY_ALG_RANDOM(N);
+
+        for (int i = 0; i < n_a; ++i) a[i] = ARRAY_ALG_RANDOM(values) - values / 2;
+        for (int i = 0; i < n_b; ++i) b[i] = ARRAY_ALG_RANDOM(values) - values / 2;
+        intv_sort(a, a + n_a, compare_int, NULL);
+        intv_sort(b, b + n_b, compare_int, NULL);
+        n_a = intv_unique(a, a + n_a, compare_int, NULL) - a;
+        n_b = intv_unique(b, b + n_b, compare_int, NULL) - b;
+
+        int n = intv_set_intersection(a, a + n_a, b, b + n_b, expected, compare_int, NULL) - expected;
+        assert(intv_set_intersection_simd(a, a + n_a, b, b + n_b, out) - out == n);
+        assert(memcmp(out, expected, n * sizeof(int)) == 0);
+        assert(intv_set_intersection_count(a, a + n_a, b, b + n_b) == (size_t)n);
+
+        // Unsigned, with negative values wrapped to the top.
+        for (int i = 0; i < n_a; ++i) u32_a[i] = (uint32_t)a[i];
+        for (int i = 0; i < n_b; ++i) u32_b[i] = (uint32_t)b[i];
+        u32v_sort(u32_a, u32_a + n_a, compare_u32, NULL);
+        u32v_sort(u32_b, u32_b + n_b, compare_u32, NULL);
+
+        n = u32v_set_intersection(u32_a, u32_a + n_a, u32_b, u32_b + n_b, u32_expected, compare_u32, NULL) - u32_expected;
+        assert(u32v_set_intersection_simd(u32_a, u32_a + n_a, u32_b, u32_b + n_b, u32_out) - u32_out == n);
+        assert(memcmp(u32_out, u32_expected, n * sizeof(uint32_t)) == 0);
+        assert(u32v_set_intersection_count(u32_b, u32_b + n_b, u32_a, u32_a + n_a) == (size_t)n);
+    }
+}
+
+static
+int compare_int_safe(const int* a, const int* b, void* ctx) {
+    return (*a > *b) - (*a < *b);
+}
+
+static
+int _random_int32(void) {
+    return (int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand());
+}
+
+void test_packed_set(void) {
+    enum { N = 1000 };
+    static int a[N];
+    static int b[N];
+    static int expected[2 * N];
+    static int out[2 * N];
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        // Spreads from all equal up to the full range of int, so widths go from 0 to 32.
+        int shift = ARRAY_ALG_RANDOM(32);
+        int n_a = ARRAY_ALG_RANDOM(N);
+        int n_b = ARRAY_ALG_RANDOM(N) >> ARRAY_ALG_RANDOM(8);
+        for (int i = 0; i < n_a; ++i) a[i] = _random_int32() >> shift;
+        for (int i = 0; i < n_b; ++i) b[i] = _random_int32() >> shift;
+        intv_sort(a, a + n_a, compare_int_safe, NULL);
+        intv_sort(b, b + n_b, compare_int_safe, NULL);
+
+        array_alg_packed_set packed_a;
+        array_alg_packed_set packed_b;
+        assert(intv_packed_set_build(&packed_a, a, a + n_a));
+        assert(intv_packed_set_build(&packed_b, b, b + n_b));
+
+        assert(intv_packed_set_decode(&packed_a, out) == out + n_a);
+        assert(memcmp(out, a, n_a * sizeof(int)) == 0);
+
+        for (int i = 0; i < 20; ++i) {
+            int x = ARRAY_ALG_RANDOM(4) == 0 || n_a == 0 ? _random_int32() : a[ARRAY_ALG_RANDOM(n_a)];
+            size_t expected_index = intv_lower_bound(a, a + n_a, &x, compare_int_safe, NULL) - a;
+            assert(intv_packed_set_lower_bound(&packed_a, &x) == expected_index);
+        }
+
+        int* expected_end = intv_set_intersection(a, a + n_a, b, b + n_b, expected, compare_int_safe, NULL);
+        int* end = intv_packed_set_intersection(&packed_a, &packed_b, out);
+        assert(end - out == expected_end - expected);
+        assert(memcmp(out, expected, (end - out) * sizeof(int)) == 0);
+
+        expected_end = intv_set_union(a, a + n_a, b, b + n_b, expected, compare_int_safe, NULL);
+        end = intv_packed_set_union(&packed_b, &packed_a, out);
+        assert(end - out == expected_end - expected);
+        assert(memcmp(out, expected, (end - out) * sizeof(int)) == 0);
+
+        intv_packed_set_free(&packed_a);
+        intv_packed_set_free(&packed_b);
+    }
+
+    // Dense ids pack to a few bits each.
+    static uint32_t ids[N * 10];
+    for (int i = 0; i < N * 10; ++i) ids[i] = 1000000 + i * 3 + ARRAY_ALG_RANDOM(3);
+    array_alg_packed_set packed;
+    assert(u32v_packed_set_build(&packed, ids, ids + N * 10));
+    assert(array_alg_packed_set_bytes(&packed) * 4 < sizeof(ids));
+    u32v_packed_set_free(&packed);
+}
+
+/// Fill chunks of 65536 values sparsely, densely or with long runs, so every container type is used.
+static int _random_roaring_values(int* out, int chunks) {
+    int n = 0;
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        int base = ((int)ARRAY_ALG_RANDOM(16) - 8) * 65536;
+        int shape = ARRAY_ALG_RANDOM(3);
+        if (shape == 0) {
+            int count = ARRAY_ALG_RANDOM(100);
+            for (int i = 0; i < count; ++i) out[n++] = base + ARRAY_ALG_RANDOM(65536);
+        } else if (shape == 1) {
+            int count = 4000 + ARRAY_ALG_RANDOM(8000);
+            for (int i = 0; i < count; ++i) out[n++] = base + ARRAY_ALG_RANDOM(65536);
+        } else {
+            int count = ARRAY_ALG_RANDOM(10);
+            for (int i = 0; i < count; ++i) {
+                int start = ARRAY_ALG_RANDOM(65536);
+                int length = ARRAY_ALG_RANDOM(5000);
+                for (int x = start; x < start + length && x < 65536; ++x) out[n++] = base + x;
+            }
+        }
+    }
+    intv_sort(out, out + n, compare_int_safe, NULL);
+    return (int)(intv_unique(out, out + n, compare_int_safe, NULL) - out);
+}
+
+void test_roaring(void) {
+    enum { N = 200000 };
+    static int a[N];
+    static int b[N];
+    static int expected[2 * N];
+    static int out[2 * N];
+
+    int types_seen[3] = { 0 };
+    for (int iteration = 0; iteration < 50; ++iteration) {
+        int n_a = _random_roaring_values(a, 4);
+        int n_b = _random_roaring_values(b, 4);
+
+        array_alg_roaring roaring_a;
+        array_alg_roaring roaring_b;
+        array_alg_roaring result;
+        assert(intv_roaring_build(&roaring_a, a, a + n_a));
+        assert(intv_roaring_build(&roaring_b, b, b + n_b));
+        assert(intv_roaring_cardinality(&roaring_a) == (size_t)n_a);
+        assert(intv_roaring_decode(&roaring_a, out) == out + n_a);
+        assert(memcmp(out, a, n_a * sizeof(int)) == 0);
+        for (size_t i = 0; i < roaring_a.count; ++i) types_seen[roaring_a.containers[i].type] = 1;
+
+        int* expected_end = intv_set_intersection(a, a + n_a, b, b + n_b, expected, compare_int_safe, NULL);
+        assert(intv_roaring_intersection(&roaring_a, &roaring_b, &result));
+        assert(intv_roaring_cardinality(&result) == (size_t)(expected_end - expected));
+        assert(intv_roaring_decode(&result, out) == out + (expected_end - expected));
+        assert(memcmp(out, expected, (expected_end - expected) * sizeof(int)) == 0);
+        intv_roaring_free(&result);
+
+        expected_end = intv_set_union(a, a + n_a, b, b + n_b, expected, compare_int_safe, NULL);
+        assert(intv_roaring_union(&roaring_a, &roaring_b, &result));
+        assert(intv_roaring_decode(&result, out) == out + (expected_end - expected));
+        assert(memcmp(out, expected, (expected_end - expected) * sizeof(int)) == 0);
+        intv_roaring_free(&result);
+
+        expected_end = intv_set_difference(a, a + n_a, b, b + n_b, expected, compare_int_safe, NULL);
+        assert(intv_roaring_difference(&roaring_a, &roaring_b, &result));
+        assert(intv_roaring_decode(&result, out) == out + (expected_end - expected));
+        assert(memcmp(out, expected, (expected_end - expected) * sizeof(int)) == 0);
+        intv_roaring_free(&result);
+
+        // Ops on the same set cover containers of equal type.
+        assert(intv_roaring_difference(&roaring_a, &roaring_a, &result));
+        assert(result.count == 0);
+        intv_roaring_free(&result);
+        assert(intv_roaring_intersection(&roaring_a, &roaring_a, &result));
+        assert(intv_roaring_cardinality(&result) == (size_t)n_a);
+        intv_roaring_free(&result);
+
+        intv_roaring_free(&roaring_a);
+        intv_roaring_free(&roaring_b);
+    }
+    assert(types_seen[ARRAY_ALG_ROARING_ARRAY] && types_seen[ARRAY_ALG_ROARING_BITMAP] && types_seen[ARRAY_ALG_ROARING_RUN]);
+
+    // Duplicates are stored once.
+    uint32_t ids[] = { 1, 1, 2, 70000, 70000 };
+    array_alg_roaring roaring;
+    assert(u32v_roaring_build(&roaring, ids, ids + ARRAY_LEN(ids)));
+    assert(u32v_roaring_cardinality(&roaring) == 3);
+    assert(roaring.count == 2);
+    u32v_roaring_free(&roaring);
+}
+
+void test_learned_index(void) {
+    enum { N = 1000 };
+    static int nums[N];
+    static double double_nums[N];
+    static array_alg_pla_segment segments[(N + 1) / 2];
+    static array_alg_pla_segment double_segments[(N + 1) / 2];
+    size_t errors[] = { 0, 1, 4, 32 };
+
+    for (int n = 0; n <= N; n += 1 + n / 4) {
+        // Uniform keys, then clustered keys with large gaps.
+        for (int shape = 0; shape < 2; ++shape) {
+            for (int i = 0; i < n; ++i) {
+                nums[i] = shape == 0 ? (int)ARRAY_ALG_RANDOM(2000) - 1000 : (int)ARRAY_ALG_RANDOM(4) * 100000 + (int)ARRAY_ALG_RANDOM(50);
+            }
+            intv_sort(nums, nums + n, compare_int, NULL);
+
+            for (int i = 0; i < n; ++i) double_nums[i] = ARRAY_ALG_RANDOM(1000) * (shape == 0 ? 0.5 : ARRAY_ALG_RANDOM(100) * 0.25);
+            doublev_sort(double_nums, double_nums + n, compare_double, NULL);
+
+            for (size_t e = 0; e < ARRAY_LEN(errors); ++e) {
+                size_t segment_count = intv_learned_index_build(nums, nums + n, errors[e], segments);
+                assert(segment_count <= (size_t)(n + 1) / 2);
+                assert((segment_count == 0) == (n == 0));
+
+                size_t double_segment_count = doublev_learned_index_build(double_nums, double_nums + n, errors[e], double_segments);
+                assert(double_segment_count <= (size_t)(n + 1) / 2);
+
+                for (int q = 0; q < 300; ++q) {
+                    int x = q < 150 ? (int)ARRAY_ALG_RANDOM(2200) - 1100 : (int)ARRAY_ALG_RANDOM(5) * 100000 + (int)ARRAY_ALG_RANDOM(60) - 5;
+                    int* expected = intv_lower_bound(nums, nums + n, &x, compare_int, NULL);
+                    assert(intv_learned_index_lower_bound(nums, nums + n, segments, segment_count, errors[e], &x) == expected);
+                    assert(intv_interpolation_lower_bound(nums, nums + n, &x) == expected);
+
+                    double d = ARRAY_ALG_RANDOM(2000) * 0.25 - 10.0;
+                    double* double_expected = doublev_lower_bound(double_nums, double_nums + n, &d, compare_double, NULL);
+                    assert(doublev_learned_index_lower_bound(double_nums, double_nums + n, double_segments, double_segment_count, errors[e], &d) == double_expected);
+                    assert(doublev_interpolation_lower_bound(double_nums, double_nums + n, &d) == double_expected);
+                }
+            }
+        }
+    }
+
+    // Evenly spaced keys are one segment.
+    for (int i = 0; i < N; ++i) nums[i] = i * 3;
+    assert(intv_learned_index_build(nums, nums + N, 0, segments) == 1);
+}
+
+void test_cascade(void) {
+    enum { K = 12, N = 200 };
+    static int arrays[K][N];
+    const int* firsts[K];
+    const int* lasts[K];
+    size_t positions[K];
+
+    for (size_t k = 0; k <= K; ++k) {
+        for (size_t i = 0; i < k; ++i) {
+            size_t n = ARRAY_ALG_RANDOM(4) == 0 ? 0 : ARRAY_ALG_RANDOM(N + 1);
+            for (size_t j = 0; j < n; ++j) arrays[i][j] = ARRAY_ALG_RANDOM(300);
+            intv_sort(arrays[i], arrays[i] + n, compare_int, NULL);
+            firsts[i] = arrays[i];
+            lasts[i] = arrays[i] + n;
+        }
+
+        array_alg_cascade cascade;
+        assert(intv_cascade_build(&cascade, firsts, lasts, k, compare_int, NULL));
+
+        for (int x = -1; x <= 301; ++x) {
+            intv_cascade_lower_bound(&cascade, &x, positions, compare_int, NULL);
+            for (size_t i = 0; i < k; ++i) {
+                assert(firsts[i] + positions[i] == intv_lower_bound(firsts[i], lasts[i], &x, compare_int, NULL));
+            }
+        }
+        intv_cascade_free(&cascade);
+    }
+}
+
+void test_bound_hint(void) {
+    enum { N = 100 };
+    int nums[N];
+
+    for (int n = 0; n <= N; n += 1 + n / 4) {
+        for (int i = 0; i < n; ++i) nums[i] = ARRAY_ALG_RANDOM(40);
+        intv_sort(nums, nums + n, compare_int, NULL);
+
+        for (int value = -1; value <= 41; ++value) {
+            int* lower = intv_lower_bound(nums, nums + n, &value, compare_int, NULL);
+            int* upper = intv_upper_bound(nums, nums + n, &value, compare_int, NULL);
+
+            for (int hint = 0; hint <= n; ++hint) {
+                assert(intv_lower_bound_hint(nums, nums + n, nums + hint, &value, compare_int, NULL) == lower);
+                assert(intv_upper_bound_hint(nums, nums + n, nums + hint, &value, compare_int, NULL) == upper);
+            }
+        }
+    }
+}
+
+void test_lower_bound_batch(void) {
+    enum { N = 300, Q = 100 };
+    int nums[N];
+    int queries[Q];
+    size_t positions[Q];
+
+    for (int n = 0; n <= N; n += 1 + n / 3) {
+        for (int i = 0; i < n; ++i) nums[i] = ARRAY_ALG_RANDOM(1000);
+        intv_sort(nums, nums + n, compare_int, NULL);
+
+        for (int q = 0; q <= Q; q += 7) {
+            for (int i = 0; i < q; ++i) queries[i] = (int)ARRAY_ALG_RANDOM(1100) - 50;
+
+            intv_lower_bound_batch(nums, nums + n, queries, q, positions, compare_int, NULL);
+            for (int i = 0; i < q; ++i) {
+                assert(nums + positions[i] == intv_lower_bound(nums, nums + n, queries + i, compare_int, NULL));
+            }
+
+            intv_sort(queries, queries + q, compare_int, NULL);
+            intv_lower_bound_batch_sorted(nums, nums + n, queries, q, positions, compare_int, NULL);
+            for (int i = 0; i < q; ++i) {
+                assert(nums + positions[i] == intv_lower_bound(nums, nums + n, queries + i, compare_int, NULL));
+            }
+        }
+    }
+}
+
 void test_permutation(void) {
     int nums[] = { 1, 2, 3, 4 };
 
@@ -549,6 +1164,274 @@ void test_heap() {
     assert(intv_is_heap(nums, nums + count, compare_int, NULL));
 }
 
+void test_minmax_heap(void) {
+    enum { N = 200 };
+    int heap[N];
+    int sorted[N];
+
+    for (int i = 0; i < N; ++i) {
+        heap[i] = ARRAY_ALG_RANDOM(100);
+        sorted[i] = heap[i];
+    }
+    intv_make_minmax_heap(heap, heap + N, compare_int, NULL);
+    assert(intv_is_minmax_heap(heap, heap + N, compare_int, NULL));
+
+    // random pushes and pops from both ends
+    int count = N;
+    for (int i = 0; i < 2000; ++i) {
+        int op = ARRAY_ALG_RANDOM(3);
+        if (op == 0 && count < N) {
+            heap[count] = ARRAY_ALG_RANDOM(100);
+            ++count;
+            intv_push_minmax_heap(heap, heap + count, compare_int, NULL);
+        } else if (op == 1 && count > 0) {
+            int min = *intv_min_element(heap, heap + count, compare_int, NULL);
+            assert(heap[0] == min);
+            intv_pop_minmax_heap_min(heap, heap + count, compare_int, NULL);
+            --count;
+            assert(heap[count] == min);
+        } else if (count > 0) {
+            int max = *intv_max_element(heap, heap + count, compare_int, NULL);
+            assert(*intv_minmax_heap_max(heap, heap + count, compare_int, NULL) == max);
+            intv_pop_minmax_heap_max(heap, heap + count, compare_int, NULL);
+            --count;
+            assert(heap[count] == max);
+        }
+        assert(intv_is_minmax_heap(heap, heap + count, compare_int, NULL));
+    }
+    assert(intv_minmax_heap_max(heap, heap, compare_int, NULL) == heap);
+
+    // popping all the maxes sorts the heap in place
+    intv_make_minmax_heap(sorted, sorted + N, compare_int, NULL);
+    for (int i = N; i > 0; --i) {
+        intv_pop_minmax_heap_max(sorted, sorted + i, compare_int, NULL);
+    }
+    assert(intv_is_sorted(sorted, sorted + N, compare_int, NULL));
+}
+
+void test_radix_heap(void) {
+    enum { N = 300 };
+    int heap[N];
+    array_alg_radix_heap radix;
+
+    for (int i = 0; i < N / 2; ++i) {
+        heap[i] = (int)ARRAY_ALG_RANDOM(1000) - 500;
+    }
+    int count = N / 2;
+    intv_make_radix_heap(heap, heap + count, &radix);
+
+    int last = *intv_min_element(heap, heap + count, compare_int, NULL);
+    for (int i = 0; i < 5000 && count > 0; ++i) {
+        if (ARRAY_ALG_RANDOM(2) == 0 && count < N) {
+            // keys may not go below the last key popped
+            heap[count] = last + (int)ARRAY_ALG_RANDOM(1 << ARRAY_ALG_RANDOM(16));
+            ++count;
+            intv_push_radix_heap(heap, heap + count, &radix);
+        } else {
+            int min = *intv_min_element(heap, heap + count, compare_int, NULL);
+            intv_pop_radix_heap(heap, heap + count, &radix);
+            --count;
+            assert(heap[count] == min);
+            assert(min >= last);
+            last = min;
+        }
+    }
+
+    intv_make_radix_heap(heap, heap, &radix);
+    assert(radix.bounds[0] == 0);
+}
+
+typedef struct {
+    array_alg_multiqueue* mq;
+    int id;
+    int operations;
+    long long pushed_sum;
+    long long popped_sum;
+} MultiQueueWorker;
+
+static
+void* _multiqueue_worker(void* arg) {
+    MultiQueueWorker* w = arg;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL * (w->id + 1);
+
+    for (int i = 0; i < w->operations; ++i) {
+        int x = (int)(array_alg_random_u64(&seed) % 100000);
+        if (intv_multiqueue_push(w->mq, &x, &seed, compare_int, NULL)) {
+            w->pushed_sum += x;
+        }
+        if (i % 2 == 0 && intv_multiqueue_pop(w->mq, &x, &seed, compare_int, NULL)) {
+            w->popped_sum += x;
+        }
+    }
+    return NULL;
+}
+
+void test_merge_parallel(void) {
+    enum { N = 400 };
+    static int a[N];
+    static int b[N];
+    static int expected[2 * N];
+    static int out[2 * N];
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        // Few distinct values, so splits land inside runs of equal elements.
+        int values = 1 + ARRAY_ALG_RANDOM(N);
+        int n_a = ARRAY_ALG_RANDOM(N);
+        int n_b = ARRAY_ALG_RANDOM(N) >> ARRAY_ALG_RANDOM(6);
+        for (int i = 0; i < n_a; ++i) a[i] = ARRAY_ALG_RANDOM(values);
+        for (int i = 0; i < n_b; ++i) b[i] = ARRAY_ALG_RANDOM(values);
+        intv_sort(a, a + n_a, compare_int, NULL);
+        intv_sort(b, b + n_b, compare_int, NULL);
+
+        for (int d = 0; d <= n_a + n_b; ++d) {
+            size_t i = intv_merge_path(a, a + n_a, b, b + n_b, d, compare_int, NULL);
+            int* end = intv_merge(a, a + i, b, b + (d - i), expected, compare_int, NULL);
+            intv_merge(a + i, a + n_a, b + (d - i), b + n_b, end, compare_int, NULL);
+            intv_merge(a, a + n_a, b, b + n_b, out, compare_int, NULL);
+            assert(memcmp(expected, out, (n_a + n_b) * sizeof(int)) == 0);
+        }
+
+        size_t threads = 1 + ARRAY_ALG_RANDOM(8);
+        int* expected_end = intv_merge(a, a + n_a, b, b + n_b, expected, compare_int, NULL);
+        int* end = intv_merge_parallel(a, a + n_a, b, b + n_b, out, threads, compare_int, NULL);
+        assert(end - out == expected_end - expected);
+        assert(memcmp(expected, out, (end - out) * sizeof(int)) == 0);
+
+        expected_end = intv_set_union(a, a + n_a, b, b + n_b, expected, compare_int, NULL);
+        end = intv_set_union_parallel(a, a + n_a, b, b + n_b, out, threads, compare_int, NULL);
+        assert(end - out == expected_end - expected);
+        assert(memcmp(expected, out, (end - out) * sizeof(int)) == 0);
+
+        expected_end = intv_set_intersection(a, a + n_a, b, b + n_b, expected, compare_int, NULL);
+        end = intv_set_intersection_parallel(a, a + n_a, b, b + n_b, out, threads, compare_int, NULL);
+        assert(end - out == expected_end - expected);
+        assert(memcmp(expected, out, (end - out) * sizeof(int)) == 0);
+
+        expected_end = intv_set_difference(a, a + n_a, b, b + n_b, expected, compare_int, NULL);
+        end = intv_set_difference_parallel(a, a + n_a, b, b + n_b, out, threads, compare_int, NULL);
+        assert(end - out == expected_end - expected);
+        assert(memcmp(expected, out, (end - out) * sizeof(int)) == 0);
+    }
+}
+
+void test_multiqueue(void) {
+    array_alg_multiqueue mq;
+    uint64_t seed = 12345;
+    {
+        enum { N = 1000 };
+        assert(!intv_multiqueue_init(&mq, 0, N));
+        assert(intv_multiqueue_init(&mq, 8, N / 8));
+
+        long long sum = 0;
+        for (int i = 0; i < N; ++i) {
+            int x = ARRAY_ALG_RANDOM(1000);
+            sum += x;
+            assert(intv_multiqueue_push(&mq, &x, &seed, compare_int, NULL));
+        }
+        int x = 0;
+        assert(!intv_multiqueue_push(&mq, &x, &seed, compare_int, NULL));
+
+        // the first pops should come from the top of some heap.
+        int first;
+        assert(intv_multiqueue_pop(&mq, &first, &seed, compare_int, NULL));
+        assert(first > 900);
+        sum -= first;
+
+        for (int i = 1; i < N; ++i) {
+            assert(intv_multiqueue_pop(&mq, &x, &seed, compare_int, NULL));
+            sum -= x;
+        }
+        assert(sum == 0);
+        assert(!intv_multiqueue_pop(&mq, &x, &seed, compare_int, NULL));
+        intv_multiqueue_free(&mq);
+    }
+    {
+        enum { THREADS = 4 };
+        assert(intv_multiqueue_init(&mq, THREADS * 2, 100000));
+
+        pthread_t threads[THREADS];
+        MultiQueueWorker workers[THREADS];
+        for (int i = 0; i < THREADS; ++i) {
+            workers[i] = (MultiQueueWorker){ &mq, i, 10000, 0, 0 };
+            pthread_create(threads + i, NULL, _multiqueue_worker, workers + i);
+        }
+
+        long long remaining = 0;
+        for (int i = 0; i < THREADS; ++i) {
+            pthread_join(threads[i], NULL);
+            remaining += workers[i].pushed_sum - workers[i].popped_sum;
+        }
+
+        int x;
+        while (intv_multiqueue_pop(&mq, &x, &seed, compare_int, NULL)) {
+            remaining -= x;
+        }
+        assert(remaining == 0);
+        intv_multiqueue_free(&mq);
+    }
+}
+
+static
+void _check_heap_indexed(Person* heap, size_t count, size_t* positions) {
+    assert(person_array_is_heap(heap, heap + count, compare_person_name, NULL));
+    for (size_t i = 0; i < count; ++i) {
+        assert(positions[heap[i].id] == i);
+    }
+}
+
+void test_heap_indexed(void) {
+    enum { N = 64 };
+    Person heap[N];
+    size_t positions[N];
+
+    for (int i = 0; i < N; ++i) {
+        heap[i].id = i;
+        snprintf(heap[i].name, 32, "%03d", (int)ARRAY_ALG_RANDOM(500));
+    }
+    person_array_make_heap_indexed(heap, heap + N, positions, compare_person_name, NULL);
+    _check_heap_indexed(heap, N, positions);
+
+    size_t count = N;
+    for (int i = 0; i < 200; ++i) {
+        Person p;
+        p.id = heap[ARRAY_ALG_RANDOM(count)].id;
+        Person* old = heap + positions[p.id];
+
+        snprintf(p.name, 32, "%03d", (int)ARRAY_ALG_RANDOM(500));
+        if (compare_person_name(&p, old, NULL) >= 0) {
+            person_array_increase_key_heap_indexed(heap, heap + count, positions, &p, compare_person_name, NULL);
+        } else {
+            person_array_decrease_key_heap_indexed(heap, heap + count, positions, &p, compare_person_name, NULL);
+        }
+        assert(strcmp(heap[positions[p.id]].name, p.name) == 0);
+        _check_heap_indexed(heap, count, positions);
+    }
+
+    // erase half, then push them back.
+    while (count > N / 2) {
+        int id = heap[ARRAY_ALG_RANDOM(count)].id;
+        person_array_erase_heap_indexed(heap, heap + count, positions, id, compare_person_name, NULL);
+        --count;
+        assert(heap[count].id == id);
+        assert(positions[id] == count);
+        _check_heap_indexed(heap, count, positions);
+    }
+    while (count < N) {
+        ++count;
+        person_array_push_heap_indexed(heap, heap + count, positions, compare_person_name, NULL);
+        _check_heap_indexed(heap, count, positions);
+    }
+
+    while (count > 0) {
+        Person max = *person_array_max_element(heap, heap + count, compare_person_name, NULL);
+        person_array_pop_heap_indexed(heap, heap + count, positions, compare_person_name, NULL);
+        --count;
+        assert(strcmp(heap[count].name, max.name) == 0);
+        assert(positions[heap[count].id] == count);
+        _check_heap_indexed(heap, count, positions);
+    }
+}
+
 static
 int _is_less_equal_than(const int* a, void* ctx)
 {
@@ -711,6 +1594,294 @@ void test_c_qsort()
     do_sort_checks(intv_c_qsort);
 }
 
+static int* numbers_find_naive(int* nums, int n, int low, int high) {
+    for (int i = 0; i < n; ++i) {
+        if (low <= nums[i] && nums[i] < high) return nums + i;
+    }
+    return nums + n;
+}
+
+// Check the SIMD scans of an instantiation against scalar loops over the same array.
+#define DEFINE_CHECK_SCANS(prefix, type) \
+static void prefix##check_scans(type* nums, int n, type x, type y) { \
+    type* expected = nums + n; \
+    type* expected_of = nums + n; \
+    type* expected_range = nums + n; \
+    size_t count = 0; \
+    size_t count_range = 0; \
+    for (int i = n - 1; i >= 0; --i) { \
+        if (nums[i] == x) { \
+            ++count; \
+            expected = nums + i; \
+        } \
+        if (nums[i] == x || nums[i] == y) expected_of = nums + i; \
+        if (x <= nums[i] && nums[i] < y) { \
+            ++count_range; \
+            expected_range = nums + i; \
+        } \
+    } \
+    type values[] = { x, y }; \
+    assert(prefix##find_value(nums, nums + n, &x) == expected); \
+    assert(prefix##count_value(nums, nums + n, &x) == count); \
+    assert(prefix##find_first_of_values(nums, nums + n, values, values + 2) == expected_of); \
+    assert(prefix##find_in_range(nums, nums + n, &x, &y) == expected_range); \
+    assert(prefix##count_in_range(nums, nums + n, &x, &y) == count_range); \
+}
+
+DEFINE_CHECK_SCANS(int8v_, int8_t)
+DEFINE_CHECK_SCANS(u16v_, uint16_t)
+DEFINE_CHECK_SCANS(int64v_, int64_t)
+DEFINE_CHECK_SCANS(floatv_, float)
+
+void test_find_value(void) {
+    enum { N = 100 };
+    int nums[N];
+    uint32_t u32s[N];
+    double doubles[N];
+    int8_t int8s[N];
+    uint16_t u16s[N];
+    int64_t int64s[N];
+    float floats[N];
+
+    for (int iteration = 0; iteration < 500; ++iteration) {
+        int n = ARRAY_ALG_RANDOM(N);
+        int spread = 1 + ARRAY_ALG_RANDOM(40);
+        for (int i = 0; i < n; ++i) {
+            nums[i] = (int)ARRAY_ALG_RANDOM(spread) - spread / 2;
+            u32s[i] = (uint32_t)nums[i];
+            doubles[i] = nums[i] * 0.5;
+        }
+
+        int x = (int)ARRAY_ALG_RANDOM(spread) - spread / 2;
+        int y = x + (int)ARRAY_ALG_RANDOM(8);
+        int values[] = { x, y, -x };
+        uint32_t u32_x = (uint32_t)x;
+        uint32_t u32_y = (uint32_t)y;
+        double double_x = x * 0.5;
+        double double_y = y * 0.5;
+
+        int* expected = numbers_find_naive(nums, n, x, x + 1);
+        assert(intv_find_value(nums, nums + n, &x) == expected);
+        assert(u32v_find_value(u32s, u32s + n, &u32_x) == u32s + (expected - nums));
+        assert(doublev_find_value(doubles, doubles + n, &double_x) == doubles + (expected - nums));
+
+        size_t count = 0;
+        size_t count_range = 0;
+        int* expected_range = nums + n;
+        int* expected_of = nums + n;
+        for (int i = n - 1; i >= 0; --i) {
+            count += nums[i] == x;
+            if (x <= nums[i] && nums[i] < y) {
+                ++count_range;
+                expected_range = nums + i;
+            }
+            if (nums[i] == x || nums[i] == y || nums[i] == -x) expected_of = nums + i;
+        }
+        assert(intv_count_value(nums, nums + n, &x) == count);
+        assert(u32v_count_value(u32s, u32s + n, &u32_x) == count);
+        assert(doublev_count_value(doubles, doubles + n, &double_x) == count);
+
+        assert(intv_find_first_of_values(nums, nums + n, values, values + 3) == expected_of);
+        assert(intv_find_first_of_values(nums, nums + n, values, values) == nums + n);
+
+        assert(intv_find_in_range(nums, nums + n, &x, &y) == expected_range);
+        assert(intv_count_in_range(nums, nums + n, &x, &y) == count_range);
+        assert(doublev_find_in_range(doubles, doubles + n, &double_x, &double_y) == doubles + (expected_range - nums));
+        assert(doublev_count_in_range(doubles, doubles + n, &double_x, &double_y) == count_range);
+        // Unsigned ranges do not wrap around.
+        if (x >= 0) {
+            assert(u32v_find_in_range(u32s, u32s + n, &u32_x, &u32_y) == u32s + (expected_range - nums));
+            assert(u32v_count_in_range(u32s, u32s + n, &u32_x, &u32_y) == count_range);
+        }
+
+        // Spread the values over the whole width of each type,
+        // so the signed and unsigned compares disagree.
+        for (int i = 0; i < n; ++i) {
+            int8s[i] = (int8_t)(nums[i] * 6);
+            u16s[i] = (uint16_t)(nums[i] * 1500);
+            int64s[i] = nums[i] * 0x100000001ll;
+            floats[i] = nums[i] * 0.5f;
+        }
+        int8v_check_scans(int8s, n, (int8_t)(x * 6), (int8_t)(y * 6));
+        u16v_check_scans(u16s, n, (uint16_t)(x * 1500), (uint16_t)(y * 1500));
+        int64v_check_scans(int64s, n, x * 0x100000001ll, y * 0x100000001ll);
+        floatv_check_scans(floats, n, x * 0.5f, y * 0.5f);
+    }
+
+    // Equality of doubles is not bitwise.
+    double zeros[] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, -0.0, NAN };
+    double zero = 0.0;
+    double nan = NAN;
+    assert(doublev_find_value(zeros, zeros + 9, &zero) == zeros + 7);
+    assert(doublev_count_value(zeros, zeros + 9, &nan) == 0);
+
+    // Extremes of the range.
+    int extremes[] = { INT_MIN, 0, INT_MAX, INT_MIN, 0, INT_MAX, INT_MIN, 0, INT_MAX };
+    int low = INT_MIN;
+    int high = INT_MAX;
+    assert(intv_count_in_range(extremes, extremes + 9, &low, &high) == 6);
+    assert(intv_find_in_range(extremes, extremes + 9, &high, &low) == extremes + 9);
+}
+
+void test_predicate_inline(void) {
+    enum { N = 100 };
+    int nums[N];
+    int copy[N];
+    int expected[N];
+    int out_true[N];
+    int out_false[N];
+    int expected_true[N];
+    int expected_false[N];
+
+    for (int iteration = 0; iteration < 500; ++iteration) {
+        int n = ARRAY_ALG_RANDOM(N);
+        // Mostly odd, so the scans often go past a whole block.
+        int odds = ARRAY_ALG_RANDOM(3);
+        for (int i = 0; i < n; ++i) {
+            nums[i] = (int)ARRAY_ALG_RANDOM(1000) - 500;
+            if (odds && ARRAY_ALG_RANDOM(100) < 98) nums[i] |= 1;
+            if (odds == 2) nums[i] &= ~1;
+        }
+
+        assert(intv_even_find_if_inline(nums, nums + n) == intv_find_if(nums, nums + n, pred_is_even, NULL));
+        assert(intv_even_any_of_inline(nums, nums + n) == intv_any_of(nums, nums + n, pred_is_even, NULL));
+        assert(intv_even_all_of_inline(nums, nums + n) == intv_all_of(nums, nums + n, pred_is_even, NULL));
+        assert(intv_even_none_of_inline(nums, nums + n) == intv_none_of(nums, nums + n, pred_is_even, NULL));
+        assert(intv_even_count_if_inline(nums, nums + n) == intv_count_if(nums, nums + n, pred_is_even, NULL));
+
+        int* expected_end = intv_copy_if(nums, nums + n, expected, pred_is_even, NULL);
+        int* end = intv_even_copy_if_inline(nums, nums + n, copy);
+        assert(end - copy == expected_end - expected);
+        assert(memcmp(copy, expected, (end - copy) * sizeof(int)) == 0);
+
+        int* t = out_true;
+        int* f = out_false;
+        int* expected_t = expected_true;
+        int* expected_f = expected_false;
+        intv_even_partition_copy_inline(nums, nums + n, &t, &f);
+        intv_partition_copy(nums, nums + n, &expected_t, &expected_f, pred_is_even, NULL);
+        assert(t - out_true == expected_t - expected_true && f - out_false == expected_f - expected_false);
+        assert(memcmp(out_true, expected_true, (t - out_true) * sizeof(int)) == 0);
+        assert(memcmp(out_false, expected_false, (f - out_false) * sizeof(int)) == 0);
+
+        memcpy(copy, nums, n * sizeof(int));
+        end = intv_even_remove_if_inline(copy, copy + n);
+        assert(end - copy == f - out_false);
+        assert(memcmp(copy, out_false, (end - copy) * sizeof(int)) == 0);
+
+        memcpy(copy, nums, n * sizeof(int));
+        int* point = intv_even_partition_inline(copy, copy + n);
+        assert(point - copy == t - out_true);
+        assert(intv_all_of(copy, point, pred_is_even, NULL));
+        assert(intv_none_of(point, copy + n, pred_is_even, NULL));
+    }
+}
+
+void test_minmax_element_simd(void) {
+    enum { N = 200 };
+    int nums[N];
+    uint32_t u32s[N];
+    double doubles[N];
+
+    for (int iteration = 0; iteration < 500; ++iteration) {
+        int n = ARRAY_ALG_RANDOM(N);
+        // Few distinct values, so there are many ties.
+        int spread = 1 + ARRAY_ALG_RANDOM(20);
+        for (int i = 0; i < n; ++i) {
+            nums[i] = (int)ARRAY_ALG_RANDOM(spread) - spread / 2;
+            u32s[i] = (uint32_t)nums[i];
+            doubles[i] = nums[i] == 0 && ARRAY_ALG_RANDOM(2) ? -0.0 : nums[i];
+        }
+        if (n > 0 && ARRAY_ALG_RANDOM(4) == 0) doubles[ARRAY_ALG_RANDOM(n)] = NAN;
+
+        int* min = intv_min_element(nums, nums + n, compare_int, NULL);
+        int* max = intv_max_element(nums, nums + n, compare_int, NULL);
+        assert(intv_min_element_simd(nums, nums + n) == min);
+        assert(intv_max_element_simd(nums, nums + n) == max);
+        assert(u32v_min_element_simd(u32s, u32s + n) == u32v_min_element(u32s, u32s + n, compare_u32, NULL));
+        assert(u32v_max_element_simd(u32s, u32s + n) == u32v_max_element(u32s, u32s + n, compare_u32, NULL));
+        assert(doublev_min_element_simd(doubles, doubles + n) == doublev_min_element(doubles, doubles + n, compare_double, NULL));
+        assert(doublev_max_element_simd(doubles, doubles + n) == doublev_max_element(doubles, doubles + n, compare_double, NULL));
+
+        if (n == 0) continue;
+        int* expected_min;
+        int* expected_max;
+        intv_minmax_element(nums, nums + n, &expected_min, &expected_max, compare_int, NULL);
+        intv_minmax_element_simd(nums, nums + n, &min, &max);
+        assert(min == expected_min && max == expected_max);
+
+        double* expected_double_min;
+        double* expected_double_max;
+        double* double_min;
+        double* double_max;
+        doublev_minmax_element(doubles, doubles + n, &expected_double_min, &expected_double_max, compare_double, NULL);
+        doublev_minmax_element_simd(doubles, doubles + n, &double_min, &double_max);
+        assert(double_min == expected_double_min && double_max == expected_double_max);
+    }
+}
+
+void test_compaction(void) {
+    enum { N = 200 };
+    int nums[N];
+    int out[N];
+    int expected[N];
+    double doubles[N];
+    double double_out[N];
+    double double_expected[N];
+
+    for (int iteration = 0; iteration < 500; ++iteration) {
+        int n = ARRAY_ALG_RANDOM(N);
+        // Runs of equal values, like a sorted column.
+        int run = 1 + ARRAY_ALG_RANDOM(6);
+        for (int i = 0; i < n; ++i) {
+            nums[i] = i > 0 && ARRAY_ALG_RANDOM(run) != 0 ? nums[i - 1] : (int)ARRAY_ALG_RANDOM(100) - 50;
+            doubles[i] = nums[i] == 0 && ARRAY_ALG_RANDOM(2) ? -0.0 : nums[i];
+            if (ARRAY_ALG_RANDOM(50) == 0) doubles[i] = NAN;
+        }
+
+        int n_expected = 0;
+        for (int i = 0; i < n; ++i) {
+            if (nums[i] % 2 == 0) expected[n_expected++] = nums[i];
+        }
+        int* end = intv_copy_if(nums, nums + n, out, pred_is_even, NULL);
+        assert(end - out == n_expected);
+        assert(memcmp(out, expected, n_expected * sizeof(int)) == 0);
+
+        n_expected = 0;
+        for (int i = 0; i < n; ++i) {
+            if (nums[i] % 2 != 0) expected[n_expected++] = nums[i];
+        }
+        memcpy(out, nums, n * sizeof(int));
+        end = intv_remove_if(out, out + n, pred_is_even, NULL);
+        assert(end - out == n_expected);
+        assert(memcmp(out, expected, n_expected * sizeof(int)) == 0);
+
+        n_expected = 0;
+        for (int i = 0; i < n; ++i) {
+            if (i == 0 || nums[i] != nums[i - 1]) expected[n_expected++] = nums[i];
+        }
+        memcpy(out, nums, n * sizeof(int));
+        end = intv_unique(out, out + n, compare_int, NULL);
+        assert(end - out == n_expected);
+        assert(memcmp(out, expected, n_expected * sizeof(int)) == 0);
+
+        memcpy(out, nums, n * sizeof(int));
+        end = intv_unique_simd(out, out + n);
+        assert(end - out == n_expected);
+        assert(memcmp(out, expected, n_expected * sizeof(int)) == 0);
+
+        // NaNs are never equal, and -0.0 equals 0.0.
+        n_expected = 0;
+        for (int i = 0; i < n; ++i) {
+            if (i == 0 || !(doubles[i] == doubles[i - 1])) double_expected[n_expected++] = doubles[i];
+        }
+        memcpy(double_out, doubles, n * sizeof(double));
+        double* double_end = doublev_unique_simd(double_out, double_out + n);
+        assert(double_end - double_out == n_expected);
+        assert(memcmp(double_out, double_expected, n_expected * sizeof(double)) == 0);
+    }
+}
+
 void test_find_unguarded(void) {
     {
         int nums[] = { 1, 2, 3, 101 };
@@ -833,12 +2004,728 @@ void benchmark_nth_element(int iterations) {
     }
 }
 
+static inline
+int compare_int_reverse(const int* a, const int* b, void* ctx) {
+    return *b - *a;
+}
+
+/// The hold model: repeatedly pop the smallest event and push it back later.
+static inline
+void benchmark_hold_model(int max_count) {
+    int count = 16;
+    while (count < max_count) {
+        int* heap = malloc(count * sizeof(int));
+        int operations = 2000000;
+
+        for (int i = 0; i < count; ++i) heap[i] = ARRAY_ALG_RANDOM(1000);
+
+        intv_make_heap(heap, heap + count, compare_int_reverse, NULL);
+        clock_t start = clock();
+        for (int i = 0; i < operations; ++i) {
+            intv_pop_heap_n(heap, count, compare_int_reverse, NULL);
+            heap[count - 1] += ARRAY_ALG_RANDOM(1000);
+            intv_push_heap_n(heap, count, compare_int_reverse, NULL);
+        }
+        clock_t binary_time = clock() - start;
+
+        for (int i = 0; i < count; ++i) heap[i] = ARRAY_ALG_RANDOM(1000);
+
+        array_alg_radix_heap radix;
+        intv_make_radix_heap(heap, heap + count, &radix);
+        start = clock();
+        for (int i = 0; i < operations; ++i) {
+            intv_pop_radix_heap(heap, heap + count, &radix);
+            heap[count - 1] += ARRAY_ALG_RANDOM(1000);
+            intv_push_radix_heap(heap, heap + count, &radix);
+        }
+        clock_t radix_time = clock() - start;
+
+        printf("%d binary: %lu radix: %lu\n", count, binary_time, radix_time);
+        free(heap);
+        count *= 4;
+    }
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    int* heap;
+    int count;
+} LockedHeap;
+
+typedef struct {
+    array_alg_multiqueue* mq;
+    LockedHeap* locked;
+    int id;
+    int operations;
+} ThroughputWorker;
+
+static
+void* _locked_heap_worker(void* arg) {
+    ThroughputWorker* w = arg;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL * (w->id + 1);
+
+    for (int i = 0; i < w->operations; ++i) {
+        int x = (int)(array_alg_random_u64(&seed) % 100000);
+        pthread_mutex_lock(&w->locked->lock);
+        w->locked->heap[w->locked->count++] = x;
+        intv_push_heap_n(w->locked->heap, w->locked->count, compare_int, NULL);
+        intv_pop_heap_n(w->locked->heap, w->locked->count--, compare_int, NULL);
+        pthread_mutex_unlock(&w->locked->lock);
+    }
+    return NULL;
+}
+
+static
+void* _multiqueue_throughput_worker(void* arg) {
+    ThroughputWorker* w = arg;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL * (w->id + 1);
+
+    for (int i = 0; i < w->operations; ++i) {
+        int x = (int)(array_alg_random_u64(&seed) % 100000);
+        intv_multiqueue_push(w->mq, &x, &seed, compare_int, NULL);
+        intv_multiqueue_pop(w->mq, &x, &seed, compare_int, NULL);
+    }
+    return NULL;
+}
+
+static
+double _wall_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static
+double _run_throughput_workers(void* (*worker)(void*), ThroughputWorker* workers, int thread_count) {
+    pthread_t threads[64];
+    double start = _wall_seconds();
+    for (int i = 0; i < thread_count; ++i) {
+        pthread_create(threads + i, NULL, worker, workers + i);
+    }
+    for (int i = 0; i < thread_count; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = _wall_seconds() - start;
+    return (double)thread_count * workers[0].operations / elapsed;
+}
+
+/// Push/pop pairs per second: one heap behind a mutex vs a multiqueue.
+static inline
+void benchmark_multiqueue(int max_threads) {
+    enum { OPERATIONS = 200000, PREFILL = 10000 };
+
+    for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        LockedHeap locked;
+        pthread_mutex_init(&locked.lock, NULL);
+        locked.heap = malloc((PREFILL + thread_count) * sizeof(int));
+        locked.count = PREFILL;
+        for (int i = 0; i < PREFILL; ++i) locked.heap[i] = ARRAY_ALG_RANDOM(100000);
+        intv_make_heap(locked.heap, locked.heap + PREFILL, compare_int, NULL);
+
+        array_alg_multiqueue mq;
+        intv_multiqueue_init(&mq, thread_count * 4, PREFILL + OPERATIONS);
+        uint64_t seed = 1;
+        for (int i = 0; i < PREFILL; ++i) {
+            int x = ARRAY_ALG_RANDOM(100000);
+            intv_multiqueue_push(&mq, &x, &seed, compare_int, NULL);
+        }
+
+        ThroughputWorker workers[64];
+        for (int i = 0; i < thread_count; ++i) {
+            workers[i] = (ThroughputWorker){ &mq, &locked, i, OPERATIONS };
+        }
+
+        double locked_rate = _run_throughput_workers(_locked_heap_worker, workers, thread_count);
+        double mq_rate = _run_throughput_workers(_multiqueue_throughput_worker, workers, thread_count);
+        printf("%d threads locked: %.0f/s multiqueue: %.0f/s\n", thread_count, locked_rate, mq_rate);
+
+        intv_multiqueue_free(&mq);
+        pthread_mutex_destroy(&locked.lock);
+        free(locked.heap);
+    }
+}
+
+static inline
+void benchmark_merge(int max_count) {
+    int* a = malloc(max_count * sizeof(int));
+    int* b = malloc(max_count * sizeof(int));
+    int* out = malloc(2 * (size_t)max_count * sizeof(int));
+
+    for (int count = 1 << 16; count <= max_count; count *= 8) {
+        for (int i = 0; i < count; ++i) a[i] = ARRAY_ALG_RANDOM(count);
+        for (int i = 0; i < count; ++i) b[i] = ARRAY_ALG_RANDOM(count);
+        intv_sort(a, a + count, compare_int, NULL);
+        intv_sort(b, b + count, compare_int, NULL);
+        int repeat = max_count / count;
+
+        clock_t start = clock();
+        for (int r = 0; r < repeat; ++r) intv_merge(a, a + count, b, b + count, out, compare_int, NULL);
+        clock_t merge_time = clock() - start;
+
+        start = clock();
+        for (int r = 0; r < repeat; ++r) intv_merge_branchless(a, a + count, b, b + count, out, compare_int, NULL);
+        clock_t branchless_time = clock() - start;
+
+        start = clock();
+        for (int r = 0; r < repeat; ++r) intv_merge_bidirectional(a, a + count, b, b + count, out, compare_int, NULL);
+        clock_t bidirectional_time = clock() - start;
+
+        printf("%d merge: %lu branchless: %lu bidirectional: %lu\n", count, merge_time, branchless_time, bidirectional_time);
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+/// Wall time of merge_parallel and set_union_parallel on two sorted runs.
+static inline
+void benchmark_merge_parallel(int count, int max_threads) {
+    int* a = malloc(count * sizeof(int));
+    int* b = malloc(count * sizeof(int));
+    int* out = malloc(2 * (size_t)count * sizeof(int));
+    for (int i = 0; i < count; ++i) a[i] = ARRAY_ALG_RANDOM(count);
+    for (int i = 0; i < count; ++i) b[i] = ARRAY_ALG_RANDOM(count);
+    intv_sort(a, a + count, compare_int, NULL);
+    intv_sort(b, b + count, compare_int, NULL);
+
+    for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        double start = _wall_seconds();
+        intv_merge_parallel(a, a + count, b, b + count, out, thread_count, compare_int, NULL);
+        double merge_time = _wall_seconds() - start;
+
+        start = _wall_seconds();
+        intv_set_union_parallel(a, a + count, b, b + count, out, thread_count, compare_int, NULL);
+        double union_time = _wall_seconds() - start;
+        printf("%d threads merge: %.3fs set_union: %.3fs\n", thread_count, merge_time, union_time);
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+static
+int _less_than(const int* a, void* ctx) {
+    return *a < *(int*)ctx;
+}
+
+/// lower_bound against a search through partition_point and a predicate closure.
+static inline
+void benchmark_lower_bound(int max_count) {
+    enum { QUERIES = 1000000 };
+    int* queries = malloc(QUERIES * sizeof(int));
+
+    int count = 1024;
+    while (count <= max_count) {
+        int* nums = malloc(count * sizeof(int));
+        for (int i = 0; i < count; ++i) nums[i] = i * 2;
+        for (int i = 0; i < QUERIES; ++i) queries[i] = ARRAY_ALG_RANDOM(count * 2);
+
+        long check = 0;
+        clock_t start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check += intv_partition_point(nums, nums + count, _less_than, queries + i) - nums;
+        }
+        clock_t predicate_time = clock() - start;
+
+        start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check -= intv_lower_bound(nums, nums + count, queries + i, compare_int, NULL) - nums;
+        }
+        clock_t lower_bound_time = clock() - start;
+        assert(check == 0);
+
+        printf("%d partition_point: %lu lower_bound: %lu\n", count, predicate_time, lower_bound_time);
+        free(nums);
+        count *= 8;
+    }
+    free(queries);
+}
+
+static
+int pred_equal_ctx(const int* x, void* ctx) {
+    return *x == *(const int*)ctx;
+}
+
+/// Scans with a predicate function against ARRAY_ALG_PREDICATE, which inlines it.
+static inline
+void benchmark_predicate_inline(int count) {
+    int* nums = malloc(count * sizeof(int));
+    int* out = malloc(count * sizeof(int));
+    // Odd, so that find_if scans everything.
+    for (int i = 0; i < count; ++i) nums[i] = (int)ARRAY_ALG_RANDOM(1000) * 2 + 1;
+
+    clock_t start = clock();
+    int* found = intv_find_if(nums, nums + count, pred_is_even, NULL);
+    clock_t find_time = clock() - start;
+    start = clock();
+    int* inline_found = intv_even_find_if_inline(nums, nums + count);
+    clock_t find_inline_time = clock() - start;
+    assert(found == inline_found);
+    printf("find_if: %lu inline: %lu\n", find_time, find_inline_time);
+
+    for (int i = 0; i < count; i += 3) nums[i] -= 1;
+
+    start = clock();
+    size_t n = intv_count_if(nums, nums + count, pred_is_even, NULL);
+    clock_t count_time = clock() - start;
+    start = clock();
+    size_t inline_n = intv_even_count_if_inline(nums, nums + count);
+    clock_t count_inline_time = clock() - start;
+    assert(n == inline_n);
+    printf("count_if: %lu inline: %lu\n", count_time, count_inline_time);
+
+    start = clock();
+    int* end = intv_copy_if(nums, nums + count, out, pred_is_even, NULL);
+    clock_t copy_time = clock() - start;
+    start = clock();
+    int* inline_end = intv_even_copy_if_inline(nums, nums + count, out);
+    clock_t copy_inline_time = clock() - start;
+    assert(end == inline_end);
+    printf("copy_if: %lu inline: %lu\n", copy_time, copy_inline_time);
+
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    end = intv_remove_if(out, out + count, pred_is_even, NULL);
+    clock_t remove_time = clock() - start;
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    inline_end = intv_even_remove_if_inline(out, out + count);
+    clock_t remove_inline_time = clock() - start;
+    assert(end - out == inline_end - out);
+    printf("remove_if: %lu inline: %lu\n", remove_time, remove_inline_time);
+
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    end = intv_partition(out, out + count, pred_is_even, NULL);
+    clock_t partition_time = clock() - start;
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    inline_end = intv_even_partition_inline(out, out + count);
+    clock_t partition_inline_time = clock() - start;
+    assert(end == inline_end);
+    printf("partition: %lu inline: %lu\n", partition_time, partition_inline_time);
+
+    free(nums);
+    free(out);
+}
+
+static inline
+void benchmark_minmax_element_simd(int count) {
+    int* nums = malloc(count * sizeof(int));
+    double* doubles = malloc(count * sizeof(double));
+    for (int i = 0; i < count; ++i) {
+        nums[i] = (int)ARRAY_ALG_RANDOM(1000000);
+        doubles[i] = nums[i] * 0.5;
+    }
+
+    clock_t start = clock();
+    int* min;
+    int* max;
+    intv_minmax_element(nums, nums + count, &min, &max, compare_int, NULL);
+    clock_t scalar_time = clock() - start;
+
+    start = clock();
+    int* simd_min;
+    int* simd_max;
+    intv_minmax_element_simd(nums, nums + count, &simd_min, &simd_max);
+    clock_t simd_time = clock() - start;
+    assert(min == simd_min && max == simd_max);
+
+    start = clock();
+    int* min_only = intv_min_element_simd(nums, nums + count);
+    clock_t min_time = clock() - start;
+    assert(min_only == min);
+
+    start = clock();
+    double* double_min;
+    double* double_max;
+    doublev_minmax_element(doubles, doubles + count, &double_min, &double_max, compare_double, NULL);
+    clock_t double_scalar_time = clock() - start;
+
+    start = clock();
+    double* double_simd_min;
+    double* double_simd_max;
+    doublev_minmax_element_simd(doubles, doubles + count, &double_simd_min, &double_simd_max);
+    clock_t double_simd_time = clock() - start;
+    assert(double_min == double_simd_min && double_max == double_simd_max);
+
+    printf("int minmax_element: %lu simd: %lu min_element_simd: %lu double minmax_element: %lu simd: %lu\n",
+            scalar_time, simd_time, min_time, double_scalar_time, double_simd_time);
+    free(nums);
+    free(doubles);
+}
+
+/// Filters and dedups of a column against memcpy of the same bytes.
+static inline
+void benchmark_compaction(int count) {
+    int* nums = malloc(count * sizeof(int));
+    int* out = malloc(count * sizeof(int));
+    for (int i = 0; i < count; ++i) nums[i] = (int)ARRAY_ALG_RANDOM(1000);
+    // Fault in the output before timing.
+    memset(out, 0, count * sizeof(int));
+
+    clock_t start = clock();
+    memcpy(out, nums, count * sizeof(int));
+    clock_t memcpy_time = clock() - start;
+
+    start = clock();
+    int* end = intv_copy_if(nums, nums + count, out, pred_is_even, NULL);
+    clock_t copy_time = clock() - start;
+
+    start = clock();
+    int* inline_end = intv_even_copy_if_inline(nums, nums + count, out);
+    clock_t copy_inline_time = clock() - start;
+    assert(end == inline_end);
+
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    end = intv_even_remove_if_inline(out, out + count);
+    clock_t remove_inline_time = clock() - start;
+
+    printf("memcpy: %lu copy_if: %lu copy_if_inline: %lu remove_if_inline: %lu\n",
+            memcpy_time, copy_time, copy_inline_time, remove_inline_time);
+
+    // A sorted column with about half of the elements repeated.
+    nums[0] = 0;
+    for (int i = 1; i < count; ++i) nums[i] = nums[i - 1] + (int)ARRAY_ALG_RANDOM(2);
+
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    end = intv_unique(out, out + count, compare_int, NULL);
+    clock_t unique_time = clock() - start;
+
+    memcpy(out, nums, count * sizeof(int));
+    start = clock();
+    int* simd_end = intv_unique_simd(out, out + count);
+    clock_t unique_simd_time = clock() - start;
+    assert(end == simd_end);
+
+    printf("unique: %lu unique_simd: %lu\n", unique_time, unique_simd_time);
+    free(nums);
+    free(out);
+}
+
+/// Scans for a value with a predicate against the SIMD scans.
+static inline
+void benchmark_find_value(int count) {
+    int* nums = malloc(count * sizeof(int));
+    for (int i = 0; i < count; ++i) nums[i] = ARRAY_ALG_RANDOM(1000);
+    // Only the last element matches.
+    int x = 1000;
+    nums[count - 1] = x;
+
+    clock_t start = clock();
+    int* found = intv_find_if(nums, nums + count, pred_equal_ctx, &x);
+    clock_t find_if_time = clock() - start;
+
+    start = clock();
+    int* simd_found = intv_find_value(nums, nums + count, &x);
+    clock_t find_value_time = clock() - start;
+    assert(found == simd_found);
+
+    x = 7;
+    start = clock();
+    size_t n = intv_count_if(nums, nums + count, pred_equal_ctx, &x);
+    clock_t count_if_time = clock() - start;
+
+    start = clock();
+    size_t simd_n = intv_count_value(nums, nums + count, &x);
+    clock_t count_value_time = clock() - start;
+    assert(n == simd_n);
+
+    int low = 100;
+    int high = 200;
+    start = clock();
+    size_t range_n = intv_count_in_range(nums, nums + count, &low, &high);
+    clock_t count_in_range_time = clock() - start;
+    assert(range_n > 0);
+
+    printf("find_if: %lu find_value: %lu count_if: %lu count_value: %lu count_in_range: %lu\n",
+            find_if_time, find_value_time, count_if_time, count_value_time, count_in_range_time);
+    free(nums);
+}
+
+static inline
+void benchmark_set_intersection(int count) {
+    int* a = malloc(count * sizeof(int));
+    int* b = malloc(count * sizeof(int));
+    int* out = malloc(count * sizeof(int));
+
+    // Dense, medium and sparse overlap.
+    for (int gap = 2; gap <= 128; gap *= 8) {
+        int na = count;
+        int nb = count;
+        a[0] = ARRAY_ALG_RANDOM(gap);
+        b[0] = ARRAY_ALG_RANDOM(gap);
+        for (int i = 1; i < count; ++i) {
+            a[i] = a[i - 1] + 1 + ARRAY_ALG_RANDOM(gap);
+            b[i] = b[i - 1] + 1 + ARRAY_ALG_RANDOM(gap);
+        }
+
+        clock_t start = clock();
+        int* end = intv_set_intersection(a, a + na, b, b + nb, out, compare_int, NULL);
+        clock_t scalar_time = clock() - start;
+
+        start = clock();
+        int* simd_end = intv_set_intersection_simd(a, a + na, b, b + nb, out);
+        clock_t simd_time = clock() - start;
+
+        start = clock();
+        size_t n = intv_set_intersection_count(a, a + na, b, b + nb);
+        clock_t count_time = clock() - start;
+        assert(simd_end - out == end - out && n == (size_t)(end - out));
+
+        printf("gap %d set_intersection: %lu simd: %lu count: %lu\n", gap, scalar_time, simd_time, count_time);
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+/// Size and intersection time of packed sets against plain sorted arrays of ids.
+static inline
+void benchmark_packed_set(int count) {
+    uint32_t* a = malloc(count * sizeof(uint32_t));
+    uint32_t* b = malloc(count * sizeof(uint32_t));
+    uint32_t* out = malloc(count * sizeof(uint32_t));
+
+    for (int gap = 2; gap <= 128; gap *= 8) {
+        a[0] = ARRAY_ALG_RANDOM(gap);
+        b[0] = ARRAY_ALG_RANDOM(gap);
+        for (int i = 1; i < count; ++i) {
+            a[i] = a[i - 1] + 1 + ARRAY_ALG_RANDOM(gap);
+            b[i] = b[i - 1] + 1 + ARRAY_ALG_RANDOM(gap);
+        }
+
+        array_alg_packed_set packed_a;
+        array_alg_packed_set packed_b;
+        u32v_packed_set_build(&packed_a, a, a + count);
+        u32v_packed_set_build(&packed_b, b, b + count);
+
+        clock_t start = clock();
+        uint32_t* end = u32v_set_intersection(a, a + count, b, b + count, out, compare_u32, NULL);
+        clock_t array_time = clock() - start;
+
+        start = clock();
+        uint32_t* packed_end = u32v_packed_set_intersection(&packed_a, &packed_b, out);
+        clock_t packed_time = clock() - start;
+        assert(end == packed_end);
+
+        printf("gap %d ratio: %.2f set_intersection: %lu packed: %lu\n", gap,
+                (double)(count * sizeof(uint32_t)) / array_alg_packed_set_bytes(&packed_a),
+                array_time, packed_time);
+        u32v_packed_set_free(&packed_a);
+        u32v_packed_set_free(&packed_b);
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+/// Intersection time of roaring sets against plain sorted arrays of dense ids.
+static inline
+void benchmark_roaring(int count) {
+    uint32_t* a = malloc(count * sizeof(uint32_t));
+    uint32_t* b = malloc(count * sizeof(uint32_t));
+    uint32_t* out = malloc(count * sizeof(uint32_t));
+
+    for (int gap = 1; gap <= 64; gap *= 4) {
+        a[0] = ARRAY_ALG_RANDOM(gap);
+        b[0] = ARRAY_ALG_RANDOM(gap);
+        for (int i = 1; i < count; ++i) {
+            a[i] = a[i - 1] + 1 + ARRAY_ALG_RANDOM(gap);
+            b[i] = b[i - 1] + 1 + ARRAY_ALG_RANDOM(gap);
+        }
+
+        array_alg_roaring roaring_a;
+        array_alg_roaring roaring_b;
+        array_alg_roaring result;
+        u32v_roaring_build(&roaring_a, a, a + count);
+        u32v_roaring_build(&roaring_b, b, b + count);
+
+        clock_t start = clock();
+        uint32_t* end = u32v_set_intersection(a, a + count, b, b + count, out, compare_u32, NULL);
+        clock_t array_time = clock() - start;
+
+        start = clock();
+        u32v_roaring_intersection(&roaring_a, &roaring_b, &result);
+        clock_t roaring_time = clock() - start;
+        assert(u32v_roaring_cardinality(&result) == (size_t)(end - out));
+
+        printf("gap %d set_intersection: %lu roaring: %lu\n", gap, array_time, roaring_time);
+        u32v_roaring_free(&result);
+        u32v_roaring_free(&roaring_a);
+        u32v_roaring_free(&roaring_b);
+    }
+    free(a);
+    free(b);
+    free(out);
+}
+
+/// lower_bound against the Eytzinger and S-tree layouts.
+static inline
+void benchmark_search_layouts(int max_count) {
+    enum { QUERIES = 1000000 };
+    int* queries = malloc(QUERIES * sizeof(int));
+
+    int count = 1024;
+    while (count <= max_count) {
+        int* nums = malloc(count * sizeof(int));
+        int* eytzinger = malloc((count + 1) * sizeof(int));
+        for (int i = 0; i < count; ++i) nums[i] = i * 2;
+        for (int i = 0; i < QUERIES; ++i) queries[i] = ARRAY_ALG_RANDOM(count * 2);
+        intv_eytzinger_build(nums, nums + count, eytzinger);
+
+        long check = 0;
+        clock_t start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check += intv_lower_bound(nums, nums + count, queries + i, compare_int, NULL) - nums;
+        }
+        clock_t lower_bound_time = clock() - start;
+
+        start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check -= intv_eytzinger_lower_bound(eytzinger, count, queries + i, compare_int, NULL);
+        }
+        clock_t eytzinger_time = clock() - start;
+        assert(check == 0);
+
+        int* stree = aligned_alloc(64, (intv_stree_size(count) * sizeof(int) + 63) / 64 * 64);
+        intv_stree_build(nums, nums + count, stree);
+        start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check += intv_stree_lower_bound(stree, count, queries + i);
+        }
+        clock_t stree_time = clock() - start;
+        start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check -= intv_lower_bound(nums, nums + count, queries + i, compare_int, NULL) - nums;
+        }
+        assert(check == 0);
+
+        start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check += intv_interpolation_lower_bound(nums, nums + count, queries + i) - nums;
+        }
+        clock_t interpolation_time = clock() - start;
+
+        array_alg_pla_segment* segments = malloc((count + 1) / 2 * sizeof(array_alg_pla_segment));
+        size_t segment_count = intv_learned_index_build(nums, nums + count, 32, segments);
+        start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            check += intv_learned_index_lower_bound(nums, nums + count, segments, segment_count, 32, queries + i) - nums;
+        }
+        clock_t learned_time = clock() - start;
+        for (int i = 0; i < QUERIES; ++i) {
+            check -= 2 * (intv_lower_bound(nums, nums + count, queries + i, compare_int, NULL) - nums);
+        }
+        assert(check == 0);
+
+        printf("%d lower_bound: %lu eytzinger: %lu stree: %lu interpolation: %lu learned: %lu\n",
+                count, lower_bound_time, eytzinger_time, stree_time, interpolation_time, learned_time);
+        free(nums);
+        free(eytzinger);
+        free(stree);
+        free(segments);
+        count *= 8;
+    }
+    free(queries);
+}
+
+static inline
+void benchmark_lower_bound_batch(int max_count) {
+    enum { QUERIES = 1000000 };
+    int* queries = malloc(QUERIES * sizeof(int));
+    size_t* positions = malloc(QUERIES * sizeof(size_t));
+
+    int count = 1024;
+    while (count <= max_count) {
+        int* nums = malloc(count * sizeof(int));
+        for (int i = 0; i < count; ++i) nums[i] = i * 2;
+        for (int i = 0; i < QUERIES; ++i) queries[i] = ARRAY_ALG_RANDOM(count * 2);
+
+        clock_t start = clock();
+        for (int i = 0; i < QUERIES; ++i) {
+            positions[i] = intv_lower_bound(nums, nums + count, queries + i, compare_int, NULL) - nums;
+        }
+        clock_t loop_time = clock() - start;
+
+        start = clock();
+        intv_lower_bound_batch(nums, nums + count, queries, QUERIES, positions, compare_int, NULL);
+        clock_t batch_time = clock() - start;
+
+        intv_sort(queries, queries + QUERIES, compare_int, NULL);
+        start = clock();
+        intv_lower_bound_batch_sorted(nums, nums + count, queries, QUERIES, positions, compare_int, NULL);
+        clock_t sorted_time = clock() - start;
+
+        printf("%d loop: %lu batch: %lu sorted: %lu\n", count, loop_time, batch_time, sorted_time);
+        free(nums);
+        count *= 8;
+    }
+    free(queries);
+    free(positions);
+}
+
+static inline
+void benchmark_cascade(int k, int max_count) {
+    enum { QUERIES = 1000000 };
+    int* queries = malloc(QUERIES * sizeof(int));
+    const int** firsts = malloc(k * sizeof(int*));
+    const int** lasts = malloc(k * sizeof(int*));
+    size_t* positions = malloc(k * sizeof(size_t));
+
+    int count = 1024;
+    while (count <= max_count) {
+        for (int i = 0; i < k; ++i) {
+            int* nums = malloc(count * sizeof(int));
+            for (int j = 0; j < count; ++j) nums[j] = ARRAY_ALG_RANDOM(count * 16);
+            intv_sort(nums, nums + count, compare_int, NULL);
+            firsts[i] = nums;
+            lasts[i] = nums + count;
+        }
+        for (int i = 0; i < QUERIES; ++i) queries[i] = ARRAY_ALG_RANDOM(count * 16);
+
+        long check = 0;
+        clock_t start = clock();
+        for (int q = 0; q < QUERIES; ++q) {
+            for (int i = 0; i < k; ++i) {
+                check += intv_lower_bound(firsts[i], lasts[i], queries + q, compare_int, NULL) - firsts[i];
+            }
+        }
+        clock_t lower_bound_time = clock() - start;
+
+        array_alg_cascade cascade;
+        intv_cascade_build(&cascade, firsts, lasts, k, compare_int, NULL);
+        start = clock();
+        for (int q = 0; q < QUERIES; ++q) {
+            intv_cascade_lower_bound(&cascade, queries + q, positions, compare_int, NULL);
+            for (int i = 0; i < k; ++i) check -= positions[i];
+        }
+        clock_t cascade_time = clock() - start;
+        assert(check == 0);
+
+        printf("%d x %d lower_bound: %lu cascade: %lu\n", k, count, lower_bound_time, cascade_time);
+        intv_cascade_free(&cascade);
+        for (int i = 0; i < k; ++i) free((int*)firsts[i]);
+        count *= 32;
+    }
+    free(queries);
+    free(firsts);
+    free(lasts);
+    free(positions);
+}
+
 int main() {
     srand(time(NULL));
     printf("-- test_predicates --\n"); test_predicates();
     printf("-- test_count --\n"); test_count();
     printf("-- test_mismatch --\n"); test_mismatch();
     printf("-- test_find --\n"); test_find();
+    printf("-- test_find_value --\n"); test_find_value();
+    printf("-- test_predicate_inline --\n"); test_predicate_inline();
+    printf("-- test_minmax_element_simd --\n"); test_minmax_element_simd();
+    printf("-- test_compaction --\n"); test_compaction();
     printf("-- test_find_unguarded --\n"); test_find_unguarded();
     printf("-- test_adjacent_find --\n"); test_adjacent_find();
     printf("-- test_find_unguarded --\n"); test_find_unguarded();
@@ -856,16 +2743,33 @@ int main() {
     printf("-- test_union --\n"); test_union();
     printf("-- test_intersect --\n"); test_intersect();
     printf("-- test_difference --\n"); test_difference();
+    printf("-- test_skewed_sets --\n"); test_skewed_sets();
+    printf("-- test_sets_k --\n"); test_sets_k();
     printf("-- test_minmax --\n"); test_minmax();
     printf("-- test_minmax_element --\n"); test_minmax_element();
     printf("-- test_partition --\n"); test_partition();
     printf("-- test_stable_partition --\n"); test_stable_partition();
     printf("-- test_is_sorted --\n"); test_is_sorted();
     printf("-- test_binary_search --\n"); test_binary_search();
+    printf("-- test_bounds --\n"); test_bounds();
+    printf("-- test_eytzinger --\n"); test_eytzinger();
+    printf("-- test_stree --\n"); test_stree();
+    printf("-- test_learned_index --\n"); test_learned_index();
+    printf("-- test_set_intersection_simd --\n"); test_set_intersection_simd();
+    printf("-- test_packed_set --\n"); test_packed_set();
+    printf("-- test_roaring --\n"); test_roaring();
+    printf("-- test_bound_hint --\n"); test_bound_hint();
+    printf("-- test_lower_bound_batch --\n"); test_lower_bound_batch();
+    printf("-- test_cascade --\n"); test_cascade();
     printf("-- test_permutation --\n"); test_permutation();
     printf("-- test_random_shuffle --\n"); test_random_shuffle();
     printf("-- test_sample --\n"); test_sample();
     printf("-- test_heap --\n"); test_heap();
+    printf("-- test_heap_indexed --\n"); test_heap_indexed();
+    printf("-- test_minmax_heap --\n"); test_minmax_heap();
+    printf("-- test_radix_heap --\n"); test_radix_heap();
+    printf("-- test_multiqueue --\n"); test_multiqueue();
+    printf("-- test_merge_parallel --\n"); test_merge_parallel();
 
     // SORTS
     printf("-- test_sort_partition -- \n"); test_sort_partition();
@@ -887,9 +2791,26 @@ int main() {
     printf("-- heap_sort --\n"); benchmark_sort(intv_heap_sort, 1000000);
     printf("-- insertion_sort --\n"); benchmark_sort(intv_insertion_sort, 20000);
     printf("-- stable_sort --\n"); benchmark_sort(intv_stable_sort, 1000000);
+    printf("-- merge --\n"); benchmark_merge(1 << 22);
     printf("-- sort --\n"); benchmark_sort(intv_sort, 1000000);
     printf("-- qsort --\n"); benchmark_sort(intv_c_qsort, 1000000);
 
     printf("-- nth_element --\n"); benchmark_nth_element(1000000);
+    printf("-- hold_model --\n"); benchmark_hold_model(1000000);
+    printf("-- multiqueue --\n"); benchmark_multiqueue(16);
+    printf("-- merge_parallel --\n"); benchmark_merge_parallel(1000000, 4);
+    printf("-- lower_bound --\n"); benchmark_lower_bound(1 << 20);
+    // Raise the limit to compare sizes up to several GB.
+    printf("-- search_layouts --\n"); benchmark_search_layouts(1 << 20);
+    printf("-- lower_bound_batch --\n"); benchmark_lower_bound_batch(1 << 20);
+    printf("-- find_value --\n"); benchmark_find_value(1 << 26);
+    printf("-- minmax_element_simd --\n"); benchmark_minmax_element_simd(1 << 24);
+    printf("-- compaction --\n"); benchmark_compaction(1 << 24);
+    printf("-- predicate_inline --\n"); benchmark_predicate_inline(1000000);
+    printf("-- set_intersection --\n"); benchmark_set_intersection(1 << 24);
+    printf("-- packed_set --\n"); benchmark_packed_set(1 << 24);
+    printf("-- roaring --\n"); benchmark_roaring(1 << 24);
+    // Raise the limit to see the cascade win again once the arrays leave the cache.
+    printf("-- cascade --\n"); benchmark_cascade(32, 1 << 15);
     return 0;
 }